@@ -71,7 +71,7 @@ static void fpu_init()
   /* Enable */
   SCB->CPACR |= ((3UL << 10 * 2) | (3UL << 11 * 2));  
 
-  /* Subnormals as zeroes */
+  /* Subnormals as zeroes, for this context only as tasks start from FPDSCR (see fpu_audio_mode) */
   __set_FPSCR(__get_FPSCR() | (1 << 24));
   __ISB(); 
   __DSB(); 
@@ -77,15 +77,14 @@
   uint32_t dwt_start, dwt_end, dwt_cycles;        \
   uint32_t dwt_time_us;                           \
   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; \
-  DWT->CYCCNT = 0;                                \
   DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
 /** 
- * \brief Resets and starts the cycle counter
- * \note Call this right before the code you want to measure
+ * \brief Starts a measurement from the current cycle count
+ * \note Call this right before the code you want to measure. The counter is free-running
+ *       and shared with the CPU governor so it is never reset.
  */
 #define DWT_CLEAR() \
-  DWT->CYCCNT = 0;  \
   dwt_start = DWT->CYCCNT;
 
 /*
@@ -0,0 +1,74 @@
+/*
+  ------------------------------------------------------------------------------
+   DAE
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ------------------------------------------------------------------------------
+*/
+#ifndef __CPU_CLOCK_H__
+#define __CPU_CLOCK_H__
+
+#include <stdint.h>
+
+/*
+ * Free-running tick counter used to measure how long audio processing takes.  On target
+ * this is the DWT cycle counter, on a host build it is the monotonic clock in nanoseconds.
+ * Only differences between two reads are meaningful, the counter wraps at 32 bits.
+ */
+#if defined(__arm__)
+
+#include "stm32f4xx.h"
+
+#define CPU_CLOCK_TICKS_PER_SECOND ((float)SystemCoreClock)
+
+static inline void cpu_clock_init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t cpu_clock_ticks(void)
+{
+  return DWT->CYCCNT;
+}
+
+#else
+
+#include <time.h>
+
+#define CPU_CLOCK_TICKS_PER_SECOND (1000000000.0f)
+
+static inline void cpu_clock_init(void)
+{
+}
+
+static inline uint32_t cpu_clock_ticks(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+#endif
+
+#endif /* __CPU_CLOCK_H__ */
@@ -26,6 +26,8 @@
   ------------------------------------------------------------------------------
 */
 #include "dae.h"
+#include "fpu.h"
+#include "cpu_clock.h"
 
 
 /* Configuration */
@@ -76,6 +78,9 @@ static float get_actual_fsr(uint32_t fsr_selected, bool mclk_enabled);
  */
 static void dae_task(void *pvParameters)
 {
+  /* Flush denormals to zero for everything rendered on this task, the boot time setting does not carry into tasks */
+  fpu_audio_mode();
+
   /* Starts the board audio subsystem (I2S and DMA peripherals) */
   audio_start(audio_buffer, DAE_AUDIO_BUFFER_SIZE, DAE_SAMPLE_RATE, DAE_IS_USING_MCLOCK);  
 
@@ -93,12 +98,13 @@ static void dae_task(void *pvParameters)
     DWT_INIT();
     DWT_CLEAR();
 
-    /* Pass the synthesiser any buffered MIDI at the start of the block, this is block level and
-       messages are not time-stamped so MIDI slicing is not possible. */
+    /* Pass the synthesiser any buffered MIDI at the start of the block, this is block level so
+       MIDI slicing is not possible.  Real-time messages keep their receive time for the clock. */
     uint8_t byte;
-    while (midi_buffer_read(&byte))
+    uint32_t timestamp;
+    while (midi_buffer_read(&byte, &timestamp))
     {
-      struct midi_msg *msg = midi_parse(&midi_in, byte);
+      struct midi_msg *msg = midi_parse(&midi_in, byte, timestamp);
       if (msg != NULL)
       {
         dae_handle_midi(msg);
@@ -181,7 +187,8 @@ void dae_ready_for_audio(enum buffer_idx buffer_idx)
 /**
  * dae_midi_received
  * \brief called by the hardware when a MIDI byte is received.  The DAE adds these to the
- *        MIDI ring_buffer for processing at the start of the next audio block.
+ *        MIDI ring_buffer for processing at the start of the next audio block, time-stamped
+ *        on arrival so MIDI clock can be tracked without the block jitter.
  * \param byte the data byte.
  */
 void dae_midi_received(uint8_t byte)
@@ -191,7 +198,7 @@ void dae_midi_received(uint8_t byte)
     return;
   }
   /* Write the byte to the MIDI ring-buffer */
-  midi_buffer_write(byte);  
+  midi_buffer_write(byte, cpu_clock_ticks());  
 }
 
 
@@ -25,19 +25,18 @@
    SOFTWARE.
   ------------------------------------------------------------------------------
 */
+#include <string.h>
+
 #include "dsp_core.h"
 
 
 /**
- * Generate white noise in the range [-1.0, 1.0].
- * Uses the standard C library rand() function.
+ * Generate white noise in the range [-1.0, 1.0).
+ * Uses the caller's xorshift32 state so it is reentrant.
  */
-float white_noise(void)
+float white_noise(uint32_t *state)
 {
-  float noise = (float)rand();
-  noise = 2.0f * (noise / (float)RAND_MAX) - 1.0f;
-
-  return noise;
+  return random_to_bipolar(xorshift32(state));
 }
 
 /**
@@ -50,16 +49,59 @@ float linear_interpolate(float x1, float x2, float y1, float y2, float x)
   return dx * y2 + (1 - dx) * y1;
 }
 
+
+/*
+ * Half-band coefficients (Kaiser window, beta 6), outermost first.  Passband to 0.2 fs and
+ * better than 60dB rejection above 0.3 fs at the oversampled rate.
+ */
+static const float halfband_coeffs[HALFBAND_COEFFS] = {
+    -0.000520927203f, 0.0015501971f, -0.00347313732f, 0.00671206805f, -0.0118438925f,
+    0.0197679565f, -0.0322144129f, 0.053539338f, -0.0997714756f, 0.316254286f};
+
+/**
+ * Clear the decimator history.
+ */
+void halfband_reset(struct halfband *hb)
+{
+  memset(hb, 0, sizeof(struct halfband));
+}
+
 /**
- * Generate a pseudo-random number using the xorshift32 algorithm.
- * Updates and returns the new state.
+ * Decimate by 2 with the half-band filter.
+ * Reads 2 * count input samples and writes count output samples, the output may be the
+ * same buffer as the input.
  */
-uint32_t xorshift32(uint32_t *state)
+void halfband_decimate(struct halfband *hb, float *output, const float *input, size_t count)
 {
-  uint32_t x = *state;
-  x ^= x << 13;
-  x ^= x >> 17;
-  x ^= x << 5;
-  *state = x;
-  return x;
+  float *out = output;
+  float *end = output + count;
+
+  uint32_t even_pos = hb->even_pos;
+  uint32_t odd_pos = hb->odd_pos;
+
+  while (out < end)
+  {
+    float centre = hb->odd[odd_pos];
+    hb->odd[odd_pos] = input[1];
+    odd_pos = (odd_pos + 1 == HALFBAND_COEFFS) ? 0 : odd_pos + 1;
+
+    hb->even[even_pos] = hb->even[even_pos + HALFBAND_EVEN_TAPS] = input[0];
+    const float *taps = &hb->even[even_pos + 1];
+    even_pos = (even_pos + 1 == HALFBAND_EVEN_TAPS) ? 0 : even_pos + 1;
+
+    /* Symmetric taps share a multiply */
+    float acc = 0.5f * centre;
+
+#pragma GCC unroll 10
+    for (int i = 0; i < HALFBAND_COEFFS; i++)
+    {
+      acc += halfband_coeffs[i] * (taps[i] + taps[HALFBAND_EVEN_TAPS - 1 - i]);
+    }
+
+    *out++ = acc;
+    input += 2;
+  }
+
+  hb->even_pos = even_pos;
+  hb->odd_pos = odd_pos;
 }
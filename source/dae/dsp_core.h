@@ -32,14 +32,69 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 #define DAE_PI (3.14159265f)
 #define DAE_TWO_PI (DAE_PI * 2.0f)
 #define DAE_DB_MIN (-96.0f)
 #define DAE_DB_MAX (6.0f)
 
-float white_noise(void);
+/*
+ * Half-band decimator, 39 taps of which every other one is zero apart from the centre (0.5).
+ * Split into polyphase branches the even input samples meet the 10 unique symmetric
+ * coefficients and the odd samples only need a delay to reach the centre tap.
+ */
+#define HALFBAND_COEFFS (10)
+#define HALFBAND_EVEN_TAPS (HALFBAND_COEFFS * 2)
+
+struct halfband
+{
+  float even[HALFBAND_EVEN_TAPS * 2]; /* Written twice so the taps are always contiguous */
+  float odd[HALFBAND_COEFFS];
+  uint32_t even_pos;
+  uint32_t odd_pos;
+};
+
+/* Recursive state below this (-300dB) is inaudible, it is cleared before it can become denormal */
+#define DSP_DENORMAL_THRESHOLD (1e-15f)
+
+/**
+ * Clears a recursive state variable once it has decayed below DSP_DENORMAL_THRESHOLD.  It is
+ * applied once per block to the saved state rather than per sample, so a silent tail stays out
+ * of the denormal range even where flush-to-zero is not enabled.
+ */
+static inline float denormal_flush(float x)
+{
+  return fabsf(x) < DSP_DENORMAL_THRESHOLD ? 0.0f : x;
+}
+
+float white_noise(uint32_t *state);
 float linear_interpolate(float x1, float x2, float y1, float y2, float x);
-uint32_t xorshift32(uint32_t *state);
+void halfband_reset(struct halfband *hb);
+void halfband_decimate(struct halfband *hb, float *output, const float *input, size_t count);
+
+/**
+ * Generate a pseudo-random number using the xorshift32 algorithm.
+ * Updates and returns the new state, the state must never be zero.
+ */
+static inline uint32_t xorshift32(uint32_t *state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/**
+ * Converts a random integer to a float in the range [-1.0, 1.0) without a divide.
+ * The top 23 bits become the mantissa of a float in [2.0, 4.0) which is then offset.
+ */
+static inline float random_to_bipolar(uint32_t random)
+{
+  union { uint32_t i; float f; } u = {0x40000000UL | (random >> 9)};
+  return u.f - 3.0f;
+}
 
 #endif
\ No newline at end of file
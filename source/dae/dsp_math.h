@@ -65,6 +65,13 @@
 
 #define FAST_LOG10(x) (FAST_LOG2(x) * 0.30103f)
 
+/* 2^x built from the exponent bits and a cubic on the fraction, error is within 0.2 cents */
+#define FAST_EXP2(x) ({ float exp2_in = (x); \
+  int exponent = (int)exp2_in - (exp2_in < 0.0f); \
+  float fraction = exp2_in - (float)exponent; \
+  union { uint32_t i; float f; } u = {(uint32_t)(exponent + 127) << 23}; \
+  u.f * (1.0f + fraction * (0.6955020f + fraction * (0.2262698f + fraction * 0.0782282f))); })
+
 float concave_inverted_transform(float value);
 float frequency_to_attenuation(float freq);
 float attenuation_to_frequency(float atten);
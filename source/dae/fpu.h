@@ -0,0 +1,86 @@
+/*
+  ------------------------------------------------------------------------------
+   DAE
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+   
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ------------------------------------------------------------------------------
+*/
+#ifndef __FPU_H__
+#define __FPU_H__
+
+#include <stdint.h>
+
+/*
+ * Floating point mode for audio processing.  Recursive DSP state (filters, envelopes) decays
+ * exponentially towards zero and would otherwise spend its silent tail as denormals, which
+ * are many times slower to process.  Flush-to-zero (and denormals-are-zero where it is a
+ * separate control) is enabled for the calling thread, so this must be called from the audio
+ * task before it renders.
+ *
+ * The board's fpu_init() already sets FZ at boot but only in the FPSCR of the startup code,
+ * FreeRTOS starts each task's floating point context from FPDSCR so it never reaches the DAE.
+ */
+#if defined(__arm__)
+
+#include "stm32f4xx.h"
+
+#define FPU_FPSCR_FZ (1UL << 24)
+
+static inline void fpu_audio_mode(void)
+{
+  /* FZ on the M4 treats denormal operands as zero too.  FPDSCR is the default for exception
+     handlers and new task floating point contexts, FPSCR is this task's own setting. */
+  FPU->FPDSCR |= FPU_FPDSCR_FZ_Msk;
+  __set_FPSCR(__get_FPSCR() | FPU_FPSCR_FZ);
+}
+
+#elif defined(__SSE__)
+
+#include <xmmintrin.h>
+
+#define FPU_MXCSR_FTZ (0x8000)
+#define FPU_MXCSR_DAZ (0x0040)
+
+static inline void fpu_audio_mode(void)
+{
+  _mm_setcsr(_mm_getcsr() | FPU_MXCSR_FTZ | FPU_MXCSR_DAZ);
+}
+
+#elif defined(__aarch64__)
+
+static inline void fpu_audio_mode(void)
+{
+  uint64_t fpcr;
+  __asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+  __asm__ volatile("msr fpcr, %0" : : "r"(fpcr | (1u << 24)));
+}
+
+#else
+
+static inline void fpu_audio_mode(void)
+{
+}
+
+#endif
+
+#endif /* __FPU_H__ */
@@ -36,27 +36,29 @@
 struct midi_ring_buffer
 {
   uint8_t buffer[MIDI_BUFFER_SIZE];
+  uint32_t timestamp[MIDI_BUFFER_SIZE];
   size_t head;
   size_t tail;
 };
 
 static struct midi_msg rt_msg;
 static struct midi_msg midi_msg;
-static struct midi_ring_buffer midi_buffer = {{0}, 0, 0};
-static struct midi_msg *midi_parse_rt_msg(struct midi_port *midi_in, uint8_t byte);
+static struct midi_ring_buffer midi_buffer = {{0}, {0}, 0, 0};
+static struct midi_msg *midi_parse_rt_msg(struct midi_port *midi_in, uint8_t byte, uint32_t timestamp);
 static bool midi_parse_message(struct midi_port *midi_in, uint8_t byte);
 
 /**
  * \brief Parse a MIDI byte and return a MIDI message
  * \param midi_in MIDI port data structure
  * \param byte MIDI byte to parse
+ * \param timestamp time the byte was received
  * \return MIDI message if a complete message is parsed, NULL otherwise.
  */
-struct midi_msg *midi_parse(struct midi_port *midi_in, uint8_t byte)
+struct midi_msg *midi_parse(struct midi_port *midi_in, uint8_t byte, uint32_t timestamp)
 {
   struct midi_msg *msg = NULL;
 
-  msg = midi_parse_rt_msg(midi_in, byte);
+  msg = midi_parse_rt_msg(midi_in, byte, timestamp);
 
   if (msg == NULL)
   {
@@ -83,12 +85,13 @@ static void midi_reset_msg(struct midi_msg *msg)
  * \brief Parse a real-time MIDI message
  * \param midi_in MIDI port data structure
  * \param byte MIDI byte to parse
+ * \param timestamp time the byte was received, kept with the message for clock tracking
  * \return MIDI message if a complete real-time message is parsed, NULL otherwise.
  * \note Real-time messages are single byte messages that can be sent at any time.
  * They are not part of the MIDI stream and can be sent between any other messages.
  * This function does not intefere with the state of any incomplete MIDI message.
  */
-static struct midi_msg *midi_parse_rt_msg(struct midi_port *midi_in, uint8_t byte)
+static struct midi_msg *midi_parse_rt_msg(struct midi_port *midi_in, uint8_t byte, uint32_t timestamp)
 {
   struct midi_msg *msg = NULL;
 
@@ -96,6 +99,7 @@ static struct midi_msg *midi_parse_rt_msg(struct midi_port *midi_in, uint8_t byt
   {
     rt_msg.data[0] = byte;
     rt_msg.len = 1;
+    rt_msg.timestamp = timestamp;
     msg = &rt_msg;
   }
 
@@ -153,7 +157,11 @@ static bool midi_parse_message(struct midi_port *midi_in, uint8_t byte)
   }
 
 
-  if (midi_in->channel != MIDI_OMNI && (running_status & CHANNEL_MASK) != (midi_in->channel - 1))
+  /* Channel messages are matched on the status, the channel stays in the message */
+  bool channel_msg = running_status < MIDI_STATUS_SYS_EX_START;
+  uint8_t status = channel_msg ? (running_status & ~CHANNEL_MASK) : running_status;
+
+  if (channel_msg && midi_in->channel != MIDI_OMNI && (running_status & CHANNEL_MASK) != (midi_in->channel - 1))
   {
     return false;
   }
@@ -171,7 +179,7 @@ static bool midi_parse_message(struct midi_port *midi_in, uint8_t byte)
     return false;
   }
 
-  switch (running_status)
+  switch (status)
   {
   case MIDI_STATUS_NOTE_ON:
   case MIDI_STATUS_NOTE_OFF:
@@ -217,15 +225,17 @@ static bool midi_parse_message(struct midi_port *midi_in, uint8_t byte)
 /**
  * \brief Write a byte to the MIDI buffer
  * \param byte Byte to write to the buffer
+ * \param timestamp Time the byte was received
  * \note This function is called by the MIDI driver to write incoming MIDI bytes to the buffer.
  */
-void midi_buffer_write(uint8_t byte)
+void midi_buffer_write(uint8_t byte, uint32_t timestamp)
 {
   uint16_t nextHead = (midi_buffer.head + 1) % MIDI_BUFFER_SIZE;
 
   if (nextHead != midi_buffer.tail)
   {
     midi_buffer.buffer[midi_buffer.head] = byte;
+    midi_buffer.timestamp[midi_buffer.head] = timestamp;
     midi_buffer.head = nextHead;
   }
 }
@@ -233,14 +243,16 @@ void midi_buffer_write(uint8_t byte)
 /**
  * \brief Read a byte from the MIDI buffer
  * \param data Pointer to a byte to store the read data
+ * \param timestamp Pointer to store the time the byte was received
  * \return true if a byte was read, false otherwise.
  * \note This function is called by the DAE to read MIDI bytes from the buffer.
  */
-bool midi_buffer_read(uint8_t *data)
+bool midi_buffer_read(uint8_t *data, uint32_t *timestamp)
 {
   if (midi_buffer.head != midi_buffer.tail)
   {
     *data = midi_buffer.buffer[midi_buffer.tail];
+    *timestamp = midi_buffer.timestamp[midi_buffer.tail];
     midi_buffer.tail = (midi_buffer.tail + 1) % MIDI_BUFFER_SIZE;
     return true;
   }
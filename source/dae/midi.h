@@ -41,6 +41,7 @@ struct midi_msg
 {
   size_t len;     
   uint8_t data[3]; 
+  uint32_t timestamp; /* Receive time of a real-time message, in cpu clock ticks */
 };
 
 struct midi_port
@@ -144,9 +145,9 @@ enum midi_cc
 
 extern const float MIDI_FREQ_TABLE[128];
 
-struct midi_msg* midi_parse(struct midi_port *in, uint8_t byte);
-void midi_buffer_write(uint8_t byte);
-bool midi_buffer_read(uint8_t* byte);
+struct midi_msg* midi_parse(struct midi_port *in, uint8_t byte, uint32_t timestamp);
+void midi_buffer_write(uint8_t byte, uint32_t timestamp);
+bool midi_buffer_read(uint8_t* byte, uint32_t *timestamp);
 float midi_to_attenuation(uint32_t midi_value);
 float attenuation_to_midi(float atten);
 
@@ -36,7 +36,7 @@
 
 
 /* Allocate new store space in blocks of this size*/
-#define DAE_PARAM_ALLOC_SIZE (64)
+#define DAE_PARAM_ALLOC_SIZE (128)
 
 /* Maximum size to which store can grow */
 #define DAE_PARAM_MAX_CAPACITY (DAE_PARAM_ALLOC_SIZE * 4)
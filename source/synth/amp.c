@@ -14,19 +14,90 @@
 
 #include "amp.h"
 
+/* MIDI pan convention, 64 is the centre */
+#define AMP_PAN_CENTRE (64)
+#define AMP_PAN_RANGE (63.0f)
 
-void amp_init(struct amp *amp, float fsr, float *samples, float *modulators)
+/* Key tracking at full amount moves a note this far from middle C to the side */
+#define AMP_PAN_TRACK_KEYS (48.0f)
+#define AMP_PAN_TRACK_NOTE (60)
+
+/* Constant power gains are scaled so the centre keeps the level of a mono mix */
+#define AMP_PAN_CENTRE_GAIN (1.41421356f)
+
+/*
+ * Stereo position for this block, from the static pan, the key and the matrix.  The gains
+ * are only recalculated when it moves, and ramp from the last block's so a modulated pan
+ * does not step.
+ */
+static void amp_pan(struct amp *amp, size_t block_size)
+{
+	float position = amp->pan_param + amp->pan_track_param * (float)(amp->note - AMP_PAN_TRACK_NOTE) * (1.0f / AMP_PAN_TRACK_KEYS) + amp->targets[MOD_TARGET_PAN];
+	position = fminf(fmaxf(position, -1.0f), 1.0f);
+
+	float left = amp->left_target;
+	float right = amp->right_target;
+
+	if (!amp->pan_valid || position != amp->pan)
+	{
+		float angle = (position + 1.0f) * (DAE_PI * 0.25f);
+		left = cosf(angle) * AMP_PAN_CENTRE_GAIN;
+		right = sinf(angle) * AMP_PAN_CENTRE_GAIN;
+		amp->pan = position;
+	}
+
+	/* The first block starts at its position, after that a new note ramps like any other move */
+	if (!amp->pan_valid)
+	{
+		amp->left_target = left;
+		amp->right_target = right;
+		amp->pan_valid = true;
+	}
+
+	amp->left_gain = amp->left_target;
+	amp->right_gain = amp->right_target;
+	amp->left_step = (left - amp->left_target) / (float)block_size;
+	amp->right_step = (right - amp->right_target) / (float)block_size;
+	amp->left_target = left;
+	amp->right_target = right;
+}
+
+
+void amp_init(struct amp *amp, float fsr, float *samples, float *modulators, const float *const *mod_samples, const float *targets, const float *envelope)
 {
 	RTT_ASSERT(amp);
 	RTT_ASSERT(samples);
 	RTT_ASSERT(modulators);
+	RTT_ASSERT(mod_samples);
+	RTT_ASSERT(targets);
+	RTT_ASSERT(envelope);
 	
 
 	amp->samples = samples;
 	amp->modulators = modulators;
+	amp->mod_samples = mod_samples;
+	amp->targets = targets;
+	amp->envelope = envelope;
 
 	amp->fsr = fsr;
-	
+	amp->peak = 0.0f;
+
+	amp->pan_param = 0.0f;
+	amp->pan_track_param = 0.0f;
+	amp->note = AMP_PAN_TRACK_NOTE;
+	amp->pan = 0.0f;
+	amp->pan_valid = false;
+	amp->left_gain = amp->right_gain = 1.0f;
+	amp->left_step = amp->right_step = 0.0f;
+	amp->left_target = amp->right_target = 1.0f;
+}
+
+/* The key sets the position for key tracked panning, it ramps there over the next block */
+void amp_note_on(struct amp *amp, uint8_t note)
+{
+	RTT_ASSERT(amp);
+
+	amp->note = note;
 }
 
 void amp_render(struct amp *amp, size_t block_size)
@@ -35,26 +106,59 @@ void amp_render(struct amp *amp, size_t block_size)
 
 	float *restrict ptr = amp->samples;
 	float *restrict end = ptr + block_size;
+	const float *restrict env = amp->envelope;
+	const float *restrict mod = amp->mod_samples[amp->mod_source_param];
 	
+	/* The envelope is applied per sample, the modulation is a block value unless its source
+	   renders at audio rate */
 	float mod_factor = 1.0f + (amp->mod_depth_param * amp->modulators[amp->mod_source_param]);
-	float scale = amp->modulators[MOD_AMP_ENV_LEVEL] * amp->gain * mod_factor;
+	float scale = amp->gain * (mod == NULL ? mod_factor : 1.0f) * (1.0f + amp->targets[MOD_TARGET_AMP]);
+	float depth = amp->mod_depth_param;
 	
 
 #ifdef DIM_OUTPUT
 	scale *= 0.25f;
 #endif	
 
+	/* Track the block peak for silence detection and voice stealing */
+	float peak = 0.0f;
+
+	if (mod == NULL)
+	{
 #pragma GCC unroll 4
-	while (ptr < end)
+		while (ptr < end)
+		{
+			float sample = *ptr * *env++ * scale;
+			*ptr++ = sample;
+
+			sample = fabsf(sample);
+			peak = (sample > peak) ? sample : peak;
+		}
+	}
+	else
 	{
-		*ptr++ *= scale;
+#pragma GCC unroll 4
+		while (ptr < end)
+		{
+			float sample = *ptr * *env++ * scale * (1.0f + depth * *mod++);
+			*ptr++ = sample;
+
+			sample = fabsf(sample);
+			peak = (sample > peak) ? sample : peak;
+		}
 	}
+
+	amp->peak = peak;
+
+	amp_pan(amp, block_size);
 }
 
-void amp_update_params(struct amp *amp, float volume, float mod_source, float mod_depth)
+void amp_update_params(struct amp *amp, float volume, float mod_source, float mod_depth, float pan, float pan_track)
 {
 	RTT_ASSERT(amp);
 	amp->gain = volume;
 	amp->mod_source_param = PARAM_TO_INT(mod_source, 0, MOD_MAX_SOURCE-1);
 	amp->mod_depth_param = mod_depth;	
+	amp->pan_param = (PARAM_TO_INT(pan, 0, 127) - AMP_PAN_CENTRE) / AMP_PAN_RANGE;
+	amp->pan_track_param = (PARAM_TO_INT(pan_track, 0, 127) - AMP_PAN_CENTRE) / AMP_PAN_RANGE;
 }
@@ -21,6 +21,7 @@
 #include "trace.h"
 
 #include "params.h"
+#include "mod_matrix.h"
 #include "dsp_core.h"
 
 
@@ -29,21 +30,39 @@ struct amp
   /* Buffers */  
   float *samples;  
   float *modulators;
+  const float *const *mod_samples; /* Per-sample modulation, NULL where block rate */
+  const float *targets; /* Modulation matrix output */
+  const float *envelope; /* Amplifier envelope level per sample */
 
   /* Parameters */
   float volume_param;
   enum mod_source mod_source_param;
   float mod_depth_param;
+  float pan_param;       /* -1 left to 1 right */
+  float pan_track_param; /* Spread by key, negative puts high notes to the left */
 
   /* Private Data */
   float fsr;
   float gain;
   uint8_t velocity;
+
+  /* Peak absolute output of the last rendered block */
+  float peak;
+
+  /* Stereo gains, worked out here and applied by the mixer so the voice buffer stays mono.
+     They start the block where the last one ended and step per sample to the target. */
+  uint8_t note;
+  float pan;  /* Position the target gains are for */
+  bool pan_valid;
+  float left_gain, right_gain;
+  float left_step, right_step;
+  float left_target, right_target;
 };
 
 /* API */
-void amp_init(struct amp *amp, float fsr, float *samples, float *modulators);
+void amp_init(struct amp *amp, float fsr, float *samples, float *modulators, const float *const *mod_samples, const float *targets, const float *envelope);
 void amp_render(struct amp *amp, size_t block_size);
-void amp_update_params(struct amp *amp, float volume, float mod_source, float mod_depth);
+void amp_note_on(struct amp *amp, uint8_t note);
+void amp_update_params(struct amp *amp, float volume, float mod_source, float mod_depth, float pan, float pan_track);
 
 #endif /* __AMP_H__ */
\ No newline at end of file
@@ -0,0 +1,188 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#include "bench.h"
+
+#ifdef SYNTH_BENCHMARK
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "cpu_clock.h"
+#include "osc.h"
+#include "filter.h"
+
+static void bench_log(const char *name, const char *stage, uint32_t ticks, size_t samples);
+static void bench_osc(const char *name, float *samples, size_t block_size, float fsr, enum osc_wave wave, float pwm_depth);
+static void bench_filter(const char *name, float *samples, size_t block_size, float fsr, enum filter_type type);
+static void bench_saw(float *samples, size_t block_size, float *phase, float inc);
+
+/**
+ * bench_run
+ * \brief Times the DSP kernels and logs the cost of each
+ * \param fsr the sample rate
+ * \param block_size the number of samples in each block
+ */
+void bench_run(float fsr, size_t block_size)
+{
+  RTT_ASSERT(fsr > 0.0f);
+  RTT_ASSERT(block_size > 0);
+
+  float *samples = pvPortMalloc(block_size * sizeof(float));
+  RTT_ASSERT(samples != NULL);
+
+  RTT_LOG("%s# Kernel benchmark, ticks per sample x10\n", RTT_CTRL_TEXT_BRIGHT_YELLOW);
+
+  /* Oscillator kernels, the pulse with its width fixed and then moving */
+  bench_osc("OSC SAW", samples, block_size, fsr, OSC_SAW, 0.0f);
+  bench_osc("OSC TRIANGLE", samples, block_size, fsr, OSC_TRIANGLE, 0.0f);
+  bench_osc("OSC PULSE", samples, block_size, fsr, OSC_PULSE, 0.0f);
+  bench_osc("OSC PWM", samples, block_size, fsr, OSC_PULSE, 0.8f);
+
+  /* The ladder and state variable filters */
+  bench_filter("FILTER LPF4", samples, block_size, fsr, FILTER_LPF4);
+  bench_filter("FILTER SVF LP", samples, block_size, fsr, FILTER_SVF_LP);
+
+  vPortFree(samples);
+}
+
+/*
+ * Logs the cost of a kernel, to a tenth of a tick per sample without floating point formatting.
+ */
+static void bench_log(const char *name, const char *stage, uint32_t ticks, size_t samples)
+{
+  uint32_t tenths = (uint32_t)(((uint64_t)ticks * 10) / samples);
+  RTT_LOG("%s# %s %s : %lu ticks/sample x10\n", RTT_CTRL_TEXT_BRIGHT_CYAN, name, stage, (unsigned long)tenths);
+}
+
+/*
+ * Renders a single oscillator at the test pitch.  With a PWM depth the LFO triangle modulator
+ * sweeps each block so the width is always moving and the PWM kernel runs.
+ */
+static void bench_osc(const char *name, float *samples, size_t block_size, float fsr, enum osc_wave wave, float pwm_depth)
+{
+  struct osc osc;
+  struct mod_matrix matrix;
+  float modulators[MOD_MAX_SOURCE];
+  const float *mod_samples[MOD_MAX_SOURCE];
+
+  memset(modulators, 0, sizeof(modulators));
+  memset(mod_samples, 0, sizeof(mod_samples));
+
+  mod_matrix_init(&matrix, modulators, mod_samples);
+  osc_init(&osc, fsr, samples, modulators, mod_samples, &matrix, true);
+  osc_update_params(&osc, (float)wave / (OSC_WAVE_MAX - 1), 0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.3f, 0.0f, pwm_depth);
+  osc_note_on(&osc, BENCH_OSC_PITCH);
+
+  uint32_t start = cpu_clock_ticks();
+
+  for (int i = 0; i < BENCH_BLOCKS; i++)
+  {
+    modulators[MOD_LFO_TRIANGLE] = (float)(i % 64) / 32.0f - 1.0f;
+    osc_render(&osc, block_size);
+  }
+
+  bench_log(name, "render", cpu_clock_ticks() - start, BENCH_BLOCKS * block_size);
+}
+
+/*
+ * Times a filter on a saw, then on silence once it has rung down, then with its state forced
+ * into the denormal range every block.  The tail costs no more than playing while the state
+ * flush (or flush-to-zero) keeps denormals out, the last figure is what a tail costs without.
+ */
+static void bench_filter(const char *name, float *samples, size_t block_size, float fsr, enum filter_type type)
+{
+  struct filter filter;
+  struct mod_matrix matrix;
+  float modulators[MOD_MAX_SOURCE];
+  const float *mod_samples[MOD_MAX_SOURCE];
+
+  memset(modulators, 0, sizeof(modulators));
+  memset(mod_samples, 0, sizeof(mod_samples));
+
+  mod_matrix_init(&matrix, modulators, mod_samples);
+  filter_init(&filter, fsr, samples, modulators, mod_samples, &matrix);
+  filter_update_params(&filter, (float)type / (FILTER_TYPE_MAX - 1), BENCH_FILTER_CUTOFF, BENCH_FILTER_RESONANCE,
+                       0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+  float phase = 0.0f;
+  float inc = BENCH_OSC_PITCH / fsr;
+  uint32_t ticks = 0;
+
+  for (int i = 0; i < BENCH_BLOCKS; i++)
+  {
+    bench_saw(samples, block_size, &phase, inc);
+    uint32_t start = cpu_clock_ticks();
+    filter_render(&filter, block_size);
+    ticks += cpu_clock_ticks() - start;
+  }
+
+  bench_log(name, "playing", ticks, BENCH_BLOCKS * block_size);
+
+  /* Only the end of the ring down is timed, by then any tail has long settled */
+  ticks = 0;
+
+  for (int i = 0; i < BENCH_TAIL_BLOCKS; i++)
+  {
+    memset(samples, 0, block_size * sizeof(float));
+    uint32_t start = cpu_clock_ticks();
+    filter_render(&filter, block_size);
+
+    if (i >= BENCH_TAIL_BLOCKS - BENCH_BLOCKS)
+    {
+      ticks += cpu_clock_ticks() - start;
+    }
+  }
+
+  bench_log(name, "tail", ticks, BENCH_BLOCKS * block_size);
+
+  ticks = 0;
+
+  for (int i = 0; i < BENCH_BLOCKS; i++)
+  {
+    memset(samples, 0, block_size * sizeof(float));
+    filter.f1.z1 = filter.f2.z1 = filter.f3.z1 = filter.f4.z1 = BENCH_DENORMAL;
+    filter.ic1eq = filter.ic2eq = BENCH_DENORMAL;
+
+    uint32_t start = cpu_clock_ticks();
+    filter_render(&filter, block_size);
+    ticks += cpu_clock_ticks() - start;
+  }
+
+  bench_log(name, "denormal", ticks, BENCH_BLOCKS * block_size);
+}
+
+/*
+ * A plain (aliased) saw, enough to keep a filter busy.
+ */
+static void bench_saw(float *samples, size_t block_size, float *phase, float inc)
+{
+  float *restrict ptr = samples;
+  float *restrict end = ptr + block_size;
+  float p = *phase;
+
+  while (ptr < end)
+  {
+    *ptr++ = UNI_TO_BI(p);
+    p += inc;
+    if (p >= 1.0f)
+    {
+      p -= 1.0f;
+    }
+  }
+
+  *phase = p;
+}
+
+#endif /* SYNTH_BENCHMARK */
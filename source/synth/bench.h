@@ -0,0 +1,45 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stddef.h>
+
+#include "trace.h"
+
+/*
+ * Kernel benchmarks, only built with SYNTH_BENCHMARK defined.  They run once from synth_init
+ * on the audio task, so with the same floating point mode as the render, and log their
+ * results over RTT in cpu clock ticks (DWT cycles on the target).
+ */
+#ifdef SYNTH_BENCHMARK
+
+/* Blocks rendered for each measurement */
+#define BENCH_BLOCKS (500)
+
+/* Test pitch of the oscillator kernels and of the filter's input */
+#define BENCH_OSC_PITCH (440.0f)
+
+/* The filters are timed playing, at the end of a ring down on silence and with their state
+   held in the denormal range, the worst case a tail can reach without flushing */
+#define BENCH_FILTER_CUTOFF (0.3f)
+#define BENCH_FILTER_RESONANCE (0.5f)
+#define BENCH_TAIL_BLOCKS (4000)
+#define BENCH_DENORMAL (1e-40f)
+
+void bench_run(float fsr, size_t block_size);
+
+#endif /* SYNTH_BENCHMARK */
+
+#endif /* __BENCH_H__ */
@@ -24,13 +24,64 @@
 #define ENV_RELEASE_MS_MIN (2.0f)
 #define ENV_POWER_EXP (1.5f)
 
+/*
+ * Segment coefficients exp(-1/x), x being the segment length in samples over the log ratio of
+ * its target overshoot, from a table on a log axis.  The table is indexed directly by the
+ * exponent and top mantissa bits of x, so a note on needs no logf/expf calls.
+ */
+#define ENV_TABLE_BITS (5) /* 32 points per octave */
+#define ENV_TABLE_EXP_MIN (-4)
+#define ENV_TABLE_OCTAVES (24)
+#define ENV_TABLE_SIZE ((ENV_TABLE_OCTAVES << ENV_TABLE_BITS) + 1)
+#define ENV_TABLE_FRAC_BITS (23 - ENV_TABLE_BITS)
+
+static float env_coeff_table[ENV_TABLE_SIZE];
+static bool env_table_ready = false;
+
+/* Fills the coefficient table, the expf() calls are made once at start up */
+static void env_build_table(void)
+{
+  for (int i = 0; i < ENV_TABLE_SIZE; i++)
+  {
+    float mantissa = 1.0f + (i & ((1 << ENV_TABLE_BITS) - 1)) / (float)(1 << ENV_TABLE_BITS);
+    float x = ldexpf(mantissa, (i >> ENV_TABLE_BITS) + ENV_TABLE_EXP_MIN);
+
+    env_coeff_table[i] = expf(-1.0f / x);
+  }
+
+  env_table_ready = true;
+}
+
+/* Coefficient for x, linearly interpolated between the table points either side */
+static inline float env_coeff(float x)
+{
+  union { float f; uint32_t i; } u = {x};
+  int octave = (int)((u.i >> 23) & 0xFF) - 127 - ENV_TABLE_EXP_MIN;
+
+  /* Segments much shorter than a sample complete at once */
+  if (octave < 0)
+  {
+    return 0.0f;
+  }
+
+  if (octave >= ENV_TABLE_OCTAVES)
+  {
+    return env_coeff_table[ENV_TABLE_SIZE - 1];
+  }
+
+  uint32_t mantissa = u.i & 0x7FFFFF;
+  int i = (octave << ENV_TABLE_BITS) + (int)(mantissa >> ENV_TABLE_FRAC_BITS);
+  float frac = (mantissa & ((1 << ENV_TABLE_FRAC_BITS) - 1)) * (1.0f / (1 << ENV_TABLE_FRAC_BITS));
+
+  return env_coeff_table[i] + frac * (env_coeff_table[i + 1] - env_coeff_table[i]);
+}
+
 /**  
  * recalc_coefficients
  * \brief Calculates the envelope segment coefficients for attack, decay and release curves
- * \note Implements Nigel Redmon's algorithm optimized for block processing rather than sample-by-sample.
- *       Operating at block rate provides computational efficiency:
- *       
- *       Update frequency = 375 Hz at 48kHz with 128-sample blocks
+ * \note Implements Nigel Redmon's algorithm, the coefficients are per sample so the envelope
+ *       is rendered into a sample buffer.  Stepping once per block turned a 1ms attack into
+ *       a 2.7ms staircase at 48kHz with 128-sample blocks, which clicked.
  * 
  *       The overshoot values ensure the asymptotic curves properly reach their targets.
  * 
@@ -38,29 +89,48 @@
  */
 static void recalc_coefficients(struct env_gen *env_gen)
 {
-  float attack_blocks = env_gen->attack_param * env_gen->attack_scaler * env_gen->fsr / (1000.0f * env_gen->block_size);
-  float decay_blocks = env_gen->decay_param * env_gen->decay_scaler * env_gen->fsr / (1000.0f * env_gen->block_size);
-  float release_blocks = env_gen->release_param * env_gen->fsr / (1000.0f * env_gen->block_size);
-
-  /* Compute base coefficients using block-based calculations */
-  env_gen->attack_coeff = MATH_EXP(-logf((1.0f + env_gen->attack_tco) / env_gen->attack_tco) / attack_blocks);
+  /* Compute base coefficients using sample-based calculations */
+  env_gen->attack_coeff = env_coeff(env_gen->attack_param * env_gen->attack_scaler * env_gen->attack_scale);
   env_gen->attack_overshoot = (1.0f + env_gen->attack_tco) * (1.0f - env_gen->attack_coeff);
 
-  env_gen->decay_coeff = MATH_EXP(-logf((1.0f + env_gen->decay_tco) / env_gen->decay_tco) / decay_blocks);
+  env_gen->decay_coeff = env_coeff(env_gen->decay_param * env_gen->decay_scaler * env_gen->decay_scale);
   env_gen->decay_overshoot = (env_gen->sustain_param - env_gen->decay_tco) * (1.0f - env_gen->decay_coeff);
 
-  env_gen->release_coeff = MATH_EXP(-logf((1.0f + env_gen->release_tco) / env_gen->release_tco) / release_blocks);
+  env_gen->release_coeff = env_coeff(env_gen->release_param * env_gen->release_scale);
   env_gen->release_overshoot = -env_gen->release_tco * (1.0f - env_gen->release_coeff);
 }
 
+/*
+ * Each state handler renders levels into the buffer until it has written count samples or the
+ * state changes, and returns the number written.  The render loop calls the handler for the
+ * new state to fill the rest of the block.
+ */
+
+/* Fills a run of the buffer with a constant level */
+static size_t env_fill(float *restrict out, size_t count, float level)
+{
+  float *restrict end = out + count;
+
+#pragma GCC unroll 4
+  while (out < end)
+  {
+    *out++ = level;
+  }
+
+  return count;
+}
+
 /**  
  * env_state_off 
  * \brief Implements the OFF state - the final envelope state where output is zero
  * \param env_gen Pointer to the envelope generator instance
+ * \param out Level buffer
+ * \param count Samples remaining in the block
  */
-static void env_state_off(struct env_gen *env_gen)
+static size_t env_state_off(struct env_gen *env_gen, float *restrict out, size_t count)
 {
   env_gen->level = 0.0f;
+  return env_fill(out, count, 0.0f);
 }
 
 
@@ -71,16 +141,31 @@ static void env_state_off(struct env_gen *env_gen)
  *       - Level reaches 1.0 (full amplitude)
  *       - Attack time is zero (immediate attack)
  * \param env_gen Pointer to the envelope generator instance
+ * \param out Level buffer
+ * \param count Samples remaining in the block
  */
-static void env_state_attack(struct env_gen *env_gen)
+static size_t env_state_attack(struct env_gen *env_gen, float *restrict out, size_t count)
 {
-  env_gen->level = env_gen->level * env_gen->attack_coeff + env_gen->attack_overshoot;
+  float level = env_gen->level;
+  size_t n = 0;
 
-  if (env_gen->level >= 1.0f || env_gen->attack_param <= 0.0f)
+  while (n < count)
   {
-    env_gen->level = 1.0f;
-    env_gen->state = ENV_DECAY;
+    level = level * env_gen->attack_coeff + env_gen->attack_overshoot;
+
+    if (level >= 1.0f || env_gen->attack_param <= 0.0f)
+    {
+      out[n++] = 1.0f;
+      level = 1.0f;
+      env_gen->state = ENV_DECAY;
+      break;
+    }
+
+    out[n++] = level;
   }
+
+  env_gen->level = level;
+  return n;
 }
 
 /**  
@@ -90,16 +175,31 @@ static void env_state_attack(struct env_gen *env_gen)
  *       - Level reaches the sustain level
  *       - Decay time is zero (immediate decay)
  * \param env_gen Pointer to the envelope generator instance
+ * \param out Level buffer
+ * \param count Samples remaining in the block
  */
-static void env_state_decay(struct env_gen *env_gen)
+static size_t env_state_decay(struct env_gen *env_gen, float *restrict out, size_t count)
 {
-  env_gen->level = env_gen->level * env_gen->decay_coeff + env_gen->decay_overshoot;
+  float level = env_gen->level;
+  size_t n = 0;
 
-  if (env_gen->level <= env_gen->sustain_param || env_gen->decay_param <= 0.0f)
+  while (n < count)
   {
-    env_gen->level = env_gen->sustain_param;
-    env_gen->state = ENV_SUSTAIN;
+    level = level * env_gen->decay_coeff + env_gen->decay_overshoot;
+
+    if (level <= env_gen->sustain_param || env_gen->decay_param <= 0.0f)
+    {
+      out[n++] = env_gen->sustain_param;
+      level = env_gen->sustain_param;
+      env_gen->state = ENV_SUSTAIN;
+      break;
+    }
+
+    out[n++] = level;
   }
+
+  env_gen->level = level;
+  return n;
 }
 
 /**  
@@ -108,10 +208,13 @@ static void env_state_decay(struct env_gen *env_gen)
  * \note This state has no automatic transition - it remains active until explicitly
  *       changed by a note-off event triggering the RELEASE state.
  * \param env_gen Pointer to the envelope generator instance
+ * \param out Level buffer
+ * \param count Samples remaining in the block
  */
-static void env_state_sustain(struct env_gen *env_gen)
+static size_t env_state_sustain(struct env_gen *env_gen, float *restrict out, size_t count)
 {
   env_gen->level = env_gen->sustain_param;
+  return env_fill(out, count, env_gen->level);
 }
 
 /**
@@ -120,16 +223,31 @@ static void env_state_sustain(struct env_gen *env_gen)
  * \note Triggered by note-off event, not by an automatic state transition.
  *       Transitions to OFF state when amplitude reaches zero or release time is zero.
  * \param env_gen Pointer to the envelope generator instance 
+ * \param out Level buffer
+ * \param count Samples remaining in the block
  */
-static void env_state_release(struct env_gen *env_gen)
+static size_t env_state_release(struct env_gen *env_gen, float *restrict out, size_t count)
 {
-  env_gen->level = env_gen->level * env_gen->release_coeff + env_gen->release_overshoot;
+  float level = env_gen->level;
+  size_t n = 0;
 
-  if (env_gen->level <= 0.0f || env_gen->release_param <= 0.0f)
+  while (n < count)
   {
-    env_gen->level = 0.0f;
-    env_gen->state = ENV_OFF;
+    level = level * env_gen->release_coeff + env_gen->release_overshoot;
+
+    if (level <= 0.0f || env_gen->release_param <= 0.0f)
+    {
+      out[n++] = 0.0f;
+      level = 0.0f;
+      env_gen->state = ENV_OFF;
+      break;
+    }
+
+    out[n++] = level;
   }
+
+  env_gen->level = level;
+  return n;
 }
 
 /**
@@ -139,22 +257,36 @@ static void env_state_release(struct env_gen *env_gen)
  *       a voice needs to be quickly silenced. Uses linear ramp rather than
  *       exponential curve for predictable timing.
  * \param env_gen Pointer to the envelope generator instance 
+ * \param out Level buffer
+ * \param count Samples remaining in the block
  */
-static void env_state_shutdown(struct env_gen *env_gen)
+static size_t env_state_shutdown(struct env_gen *env_gen, float *restrict out, size_t count)
 {
+  float level = env_gen->level;
+  size_t n = 0;
 
-  env_gen->level += env_gen->inc_shutdown;
-
-  /* Off */
-  if (env_gen->level <= 0.0f)
+  while (n < count)
   {
-    env_gen->level = 0.0f; /* Clear any overshoot caused by RTZ */
-    env_gen->state = ENV_OFF;
+    level += env_gen->inc_shutdown;
+
+    /* Off */
+    if (level <= 0.0f)
+    {
+      out[n++] = 0.0f;
+      level = 0.0f; /* Clear any overshoot caused by RTZ */
+      env_gen->state = ENV_OFF;
+      break;
+    }
+
+    out[n++] = level;
   }
+
+  env_gen->level = level;
+  return n;
 }
 
 /* The lookup (jump) table of state handlers */
-static void (*env_state_handlers[ENV_MAX])(struct env_gen *env_gen) =
+static size_t (*env_state_handlers[ENV_MAX])(struct env_gen *env_gen, float *restrict out, size_t count) =
     {
         env_state_off,
         env_state_attack,
@@ -196,22 +328,54 @@ static float (*env_transforms[TRANSFORM_MAX])(float level, float sustain) =
         env_mode_inverted,
         env_mode_biased_inverted};
 
-void env_gen_init(struct env_gen *env_gen, float fsr, size_t block_size, float *env_level)
+void env_gen_init(struct env_gen *env_gen, float fsr, size_t block_size, float *env_level, float *env_buffer)
 {
   RTT_ASSERT(env_gen != NULL);  
+  RTT_ASSERT(env_buffer != NULL);
+
+  env_gen_table_init();
 
   env_gen->attack_tco = MATH_EXP(-1.5f);
   env_gen->decay_tco = MATH_EXP(-4.95f);
   env_gen->release_tco = env_gen->decay_tco;
   env_gen->fsr = fsr;
+
+  /* Milliseconds to the coefficient table's x for each segment, the logs are constant */
+  env_gen->attack_scale = fsr / (1000.0f * logf((1.0f + env_gen->attack_tco) / env_gen->attack_tco));
+  env_gen->decay_scale = fsr / (1000.0f * logf((1.0f + env_gen->decay_tco) / env_gen->decay_tco));
+  env_gen->release_scale = fsr / (1000.0f * logf((1.0f + env_gen->release_tco) / env_gen->release_tco));
   env_gen->block_size = block_size;  
   env_gen->env_level = env_level;
+  env_gen->env_buffer = env_buffer;
 
   env_gen_reset(env_gen);
 
   RTT_LOG("EG initialised\n");
 }
 
+/**
+ * env_gen_table_init
+ * \brief Builds the segment coefficient table shared by the envelope generators, once
+ */
+void env_gen_table_init(void)
+{
+  if (!env_table_ready)
+  {
+    env_build_table();
+  }
+}
+
+/**
+ * env_gen_coeff
+ * \brief Looks up an exponential segment coefficient exp(-1/x) from the shared table
+ * \note For other envelopes, env_gen_table_init() must have been called first.
+ * \param x the segment length over the log ratio of its target overshoot
+ */
+float env_gen_coeff(float x)
+{
+  return env_coeff(x);
+}
+
 void env_gen_reset(struct env_gen *env_gen)
 {
   RTT_ASSERT(env_gen != NULL);
@@ -223,8 +387,10 @@ void env_gen_reset(struct env_gen *env_gen)
 /**
  * env_gen_render
  * \brief Processes one block of the envelope generator state machine
- * \note Calls the appropriate state handler function based on current state
- *       and applies the configured output transform mode to the result.
+ * \note Calls the state handlers to render the level of each sample into the envelope
+ *       buffer, a state change part way through continues in the new state.  The
+ *       configured output transform is applied to the final level for the modulators.
+ *       The buffer holds the untransformed level.
  * \param env_gen Pointer to the envelope generator instance
  * \param block_size Number of samples to process (typically matches initialization value)
  */
@@ -232,7 +398,14 @@ void env_gen_render(struct env_gen *env_gen, size_t block_size)
 {
   RTT_ASSERT(env_gen != NULL);  
 
-  env_state_handlers[env_gen->state](env_gen);
+  float *restrict out = env_gen->env_buffer;
+  size_t done = 0;
+
+  while (done < block_size)
+  {
+    done += env_state_handlers[env_gen->state](env_gen, out + done, block_size - done);
+  }
+
   *env_gen->env_level = env_transforms[env_gen->mode_param](env_gen->level, env_gen->sustain_param);
 }
 
@@ -325,14 +498,15 @@ void env_gen_rtz(struct env_gen *env_gen)
 
   if (env_gen->level > 0.0f)
   {
-    /* Calculate the number of blocks needed to fade to 0 */
-    float shutdown_blocks = env_gen->block_size / env_gen->fsr; /* Time in seconds per block */
-    float total_shutdown_time = fmaxf(shutdown_blocks, 1.0f);   /* Ensure at least one block */
-
-    /* Compute the decrement step per block */
-    env_gen->inc_shutdown = -(env_gen->level / total_shutdown_time);
+    /* Linear ramp reaching 0 by the end of one block, rather than a step */
+    env_gen->inc_shutdown = -(env_gen->level / fmaxf(env_gen->block_size - 1.0f, 1.0f));
 
     /* Move to shutdown state */
     env_gen->state = ENV_SHUTDOWN;
   }
+  else
+  {
+    /* Already silent so finish immediately */
+    env_gen->state = ENV_OFF;
+  }
 }
@@ -46,8 +46,9 @@ enum env_state
 
 struct env_gen
 {
-  /* Output value */
+  /* Output value for the modulators and the per-sample level for the block */
   float *env_level;  
+  float *env_buffer;
 
   /* Parameters */
   float attack_param, decay_param, sustain_param, release_param;
@@ -69,6 +70,9 @@ struct env_gen
   float attack_tco;
   float decay_tco;
   float release_tco;
+  float attack_scale;
+  float decay_scale;
+  float release_scale;
   float attack_overshoot;
   float decay_overshoot;
   float release_overshoot;
@@ -77,8 +81,10 @@ struct env_gen
   float inc_shutdown;
 };
 
-void env_gen_init(struct env_gen *env, float fsr, size_t block_size, float *env_level);
+void env_gen_init(struct env_gen *env, float fsr, size_t block_size, float *env_level, float *env_buffer);
 void env_gen_reset(struct env_gen *env);
+void env_gen_table_init(void);
+float env_gen_coeff(float x);
 void env_gen_render(struct env_gen *env, size_t block_size);
 void env_gen_note_on(struct env_gen *env_gen, uint8_t midi_note, uint8_t midi_veloc);
 void env_gen_note_off(struct env_gen *env);
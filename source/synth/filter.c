@@ -27,46 +27,86 @@
 #define FILTER_MOD_MAX (4.0f)
 
 #define T (0.0000224f)
-#define TWO_OVER_T (2.0f / T)
-#define T_OVER_2 (T / 2.0f)
 
-/* TODO  Filter tracking - MIDI note is now fed via a note_on()  but no alogrithm */
+/* Modulation range, +/- log2(FILTER_MOD_MAX) octaves */
+#define FILTER_MOD_OCTAVES (2.0f)
 
-void filter_init(struct filter *filter, float fsr, float *samples, float *modulators)
+/* Key tracking follows the keyboard an octave per octave around this note */
+#define FILTER_TRACK_NOTE (60)
+
+/* Velocity tracking closes the cutoff by up to this many octaves for the softest notes */
+#define FILTER_VEL_OCTAVES (2.0f)
+
+/*
+ * Coefficient table over a log frequency axis, 24 points per octave from an octave below
+ * FILTER_CUT_MIN (the bottom of the range when oversampled 2x) up to FILTER_CUT_MAX.
+ */
+#define FILTER_TABLE_STEPS (24.0f) /* Interpolation error below 0.5 cents */
+#define FILTER_TABLE_OCTAVES (9)
+#define FILTER_TABLE_SIZE (FILTER_TABLE_OCTAVES * 24 + 2)
+#define FILTER_CUT_OCTAVES (7.8138f) /* log2(FILTER_CUT_MAX / FILTER_CUT_MIN) */
+
+/* State variable filter damping (1/Q) at minimum and maximum resonance */
+#define FILTER_SVF_K_MAX (2.0f)
+#define FILTER_SVF_K_MIN (0.05f)
+
+/* The prewarped one pole gain g, with G = g / (1 + g) and B = 1 / (1 + g) for the ladder */
+struct filter_table_entry
+{
+  float g;
+  float G;
+  float B;
+};
+
+static struct filter_table_entry filter_table[FILTER_TABLE_SIZE];
+static bool filter_table_ready = false;
+
+/* Fills the coefficient table, the tanf() calls are made once at start up rather than per block */
+static void filter_build_table(void)
+{
+  for (int i = 0; i < FILTER_TABLE_SIZE; i++)
+  {
+    float cutoff = (FILTER_CUT_MIN * 0.5f) * powf(2.0f, i / FILTER_TABLE_STEPS);
+
+    /* Bilinear prewarp, (2/T) * tan(wT/2) * (T/2) */
+    float g = tanf(DAE_PI * fminf(cutoff, FILTER_CUT_MAX) * T);
+
+    filter_table[i].g = g;
+    filter_table[i].G = g / (1.0f + g);
+    filter_table[i].B = 1.0f / (1.0f + g);
+  }
+
+  filter_table_ready = true;
+}
+
+void filter_init(struct filter *filter, float fsr, float *samples, float *modulators, const float *const *mod_samples, const struct mod_matrix *matrix)
 {
   RTT_ASSERT(filter != NULL);
   RTT_ASSERT(samples != NULL);
   RTT_ASSERT(modulators != NULL);  
+  RTT_ASSERT(mod_samples != NULL);
+  RTT_ASSERT(matrix != NULL);
+
+  if (!filter_table_ready)
+  {
+    filter_build_table();
+  }
 
   filter->fsr = fsr;
+  filter->rate_octaves = 0.0f;
+  filter->rate_shift = 0;
   filter->samples = samples;
   filter->modulators = modulators;
-
-  filter->cutoff = FILTER_CUT_MAX;
-  filter->alpha0 = 1.0f;
+  filter->mod_samples = mod_samples;
+  filter->matrix = matrix;
+  filter->audio_mod = NULL;
+
+  filter->cutoff_param = FILTER_CUT_OCTAVES;
+  filter->cutoff_octaves = FILTER_CUT_OCTAVES;
+  filter->cutoff_valid = false;
+  filter->track_octaves = 0.0f;
   filter->bass_comp = 1.0f;
 
-  /* Init the cascade */
-  filter->f1.alpha  = 1.0f;
-  filter->f1.beta  = 0;
-  filter->f1.z1  = 0;
-  filter->f1.a0  = 1.0f;
-
-  filter->f2.alpha = 1.0f;
-  filter->f2.beta = 0;
-  filter->f2.z1 = 0;
-  filter->f2.a0 = 1.0f;
-
-  filter->f3.alpha = 1.0f;
-  filter->f3.beta = 0;
-  filter->f3.z1 = 0;
-  filter->f3.a0 = 1.0f;
-
-  filter->f4.alpha = 1.0f;
-  filter->f4.beta = 0;
-  filter->f4.z1 = 0;
-  filter->f4.a0 = 1.0f;
-
   filter_reset(filter);
 }
 
@@ -78,89 +118,121 @@ void filter_reset(struct filter *filter)
   filter->f2.z1 = 0;
   filter->f3.z1 = 0;
   filter->f4.z1 = 0;
+  filter->ic1eq = 0;
+  filter->ic2eq = 0;
+  filter->cutoff_valid = false;
 }
 
-static void filter_calculate_coefficients(struct filter *filter)
+/* Modulated cutoff for this block in octaves above FILTER_CUT_MIN, clamped to the filter range */
+static inline float filter_cutoff_octaves(struct filter *filter)
 {
-  float lfo_mod = filter->modulators[filter->mod_source_param] * filter->mod_depth_param;  
+  float octaves = filter->cutoff_param + filter->track_octaves + filter->matrix->targets[MOD_TARGET_CUTOFF];
 
-  filter->cutoff = filter->cutoff_param * powf(FILTER_MOD_MAX, lfo_mod);
-
-  /* Clamp modulation to filter range */
-  if (filter->cutoff < FILTER_CUT_MIN)
-  {
-    filter->cutoff = FILTER_CUT_MAX;
-  }
-  else if (filter->cutoff > FILTER_CUT_MAX)
+  /* An audio rate source is added per sub-block instead, by filter_modulate */
+  if (filter->audio_mod == NULL)
   {
-    filter->cutoff = FILTER_CUT_MAX;
+    octaves += filter->modulators[filter->mod_source_param] * filter->mod_depth_param * FILTER_MOD_OCTAVES;
   }
 
-  float g = (TWO_OVER_T * tanf((DAE_TWO_PI * filter->cutoff) * T_OVER_2)) * T_OVER_2;
-  float G = g / (1.0f + g);
+  return fminf(fmaxf(octaves, 0.0f), FILTER_CUT_OCTAVES);
+}
 
-  filter->f1.alpha = G;
-  filter->f2.alpha = G;
-  filter->f3.alpha = G;
-  filter->f4.alpha = G;
+/*
+ * The cutoff is ramped from the last block's value in sub-blocks, in octaves so the sweep is
+ * even, and each sub-block's coefficients are interpolated from the table rather than
+ * calculated.  Returns the table position before the first sub-block and the step per
+ * sub-block.  The position is offset when oversampled as the same cutoff is then a lower
+ * fraction of the render rate.
+ */
+static inline float filter_ramp(struct filter *filter, size_t block_size, float *position_step)
+{
+  float octaves = filter_cutoff_octaves(filter);
 
-  filter->f1.beta = G * G * G / (1.0f + g);
-  filter->f2.beta = G * G / (1.0f + g);
-  filter->f3.beta = G / (1.0f + g);
-  filter->f4.beta = 1.0f / (1.0f + g);
+  if (!filter->cutoff_valid)
+  {
+    filter->cutoff_octaves = octaves;
+    filter->cutoff_valid = true;
+  }
 
-  float gamma = G * G * G * G;
-  filter->alpha0 = 1.0f / (1.0f + filter->resonance_param * gamma);
-}
+  float position = (filter->cutoff_octaves + 1.0f - filter->rate_octaves) * FILTER_TABLE_STEPS;
+  *position_step = (octaves - filter->cutoff_octaves) * FILTER_TABLE_STEPS * FILTER_SUB_BLOCK / (float)block_size;
+  filter->cutoff_octaves = octaves;
 
-typedef void (*output_func)(float *output, float U, float lpf1, float lpf2, float lpf3, float lpf4);
-typedef void (*filter_func)(struct filter *, size_t, output_func select_taps);
+  return position;
+}
 
-struct jump_table_entry
+/*
+ * Adds the audio rate sources, the filter's own and any matrix routes, to a sub-block's table
+ * position.  They are read at the sub-block's first sample so the cutoff follows the waveform
+ * at FILTER_SUB_BLOCK resolution rather than being held for the block.  Clamped to the same
+ * range as the block rate cutoff.
+ */
+static inline float filter_modulate(const struct filter *filter, float position, size_t offset)
 {
-  filter_func filter;
-  output_func output;
-};
+  if (filter->audio_mod == NULL && filter->matrix->audio_count[MOD_TARGET_CUTOFF] == 0)
+  {
+    return position;
+  }
 
-static void output_lpf2(float *output, float U, float lpf1, float lpf2, float lpf3, float lpf4)
-{
-  *output = lpf1;
-}
+  float lowest = (1.0f - filter->rate_octaves) * FILTER_TABLE_STEPS;
+  float highest = lowest + FILTER_CUT_OCTAVES * FILTER_TABLE_STEPS;
 
-static void output_bpf2(float *output, float U, float lpf1, float lpf2, float lpf3, float lpf4)
-{
-  *output = lpf1 * 2.0f + lpf2 * -2.0f;
-}
+  size_t index = offset >> filter->rate_shift;
+  float octaves = mod_matrix_audio(filter->matrix, MOD_TARGET_CUTOFF, index);
 
-static void output_hpf2(float *output, float U, float lpf1, float lpf2, float lpf3, float lpf4)
-{
-  *output = U + lpf1 * -2.0f + lpf2;
-}
+  if (filter->audio_mod != NULL)
+  {
+    octaves += filter->audio_mod[index] * filter->mod_depth_param * FILTER_MOD_OCTAVES;
+  }
 
-static void output_lpf4(float *output, float U, float lpf1, float lpf2, float lpf3, float lpf4)
-{
-  *output = lpf4;
+  position += octaves * FILTER_TABLE_STEPS;
+
+  return fminf(fmaxf(position, lowest), highest);
 }
 
-static void output_bpf4(float *output, float U, float lpf1, float lpf2, float lpf3, float lpf4)
+/* Coefficients at a table position, linearly interpolated */
+static inline struct filter_table_entry filter_lookup(float position)
 {
-  *output = lpf2 * 4.0f + lpf3 * -8.0f + lpf4 * 4.0f;
+  int i = (int)position;
+  float frac = position - i;
+  const struct filter_table_entry *a = &filter_table[i];
+  const struct filter_table_entry *b = &filter_table[i + 1];
+
+  return (struct filter_table_entry){
+      .g = a->g + frac * (b->g - a->g),
+      .G = a->G + frac * (b->G - a->G),
+      .B = a->B + frac * (b->B - a->B)};
 }
 
-static void output_hpf4(float *output, float U, float lpf1, float lpf2, float lpf3, float lpf4)
+/* Ladder output taps, the mode is a constant in each kernel so this folds to one expression */
+static inline __attribute__((always_inline)) float ladder_output(enum filter_type type, float U, float lpf1, float lpf2, float lpf3, float lpf4)
 {
-  *output = U + lpf1 * -4.0f + lpf2 * 6.0f + lpf3 * -4.0f + lpf4;
+  switch (type)
+  {
+  case FILTER_LPF2:
+    return lpf1;
+  case FILTER_BPF2:
+    return lpf1 * 2.0f + lpf2 * -2.0f;
+  case FILTER_HPF2:
+    return U + lpf1 * -2.0f + lpf2;
+  case FILTER_LPF4:
+    return lpf4;
+  case FILTER_BPF4:
+    return lpf2 * 4.0f + lpf3 * -8.0f + lpf4 * 4.0f;
+  case FILTER_HPF4:
+  default:
+    return U + lpf1 * -4.0f + lpf2 * 6.0f + lpf3 * -4.0f + lpf4;
+  }
 }
 
-static void internal_filter_render(struct filter * filter, size_t block_size, output_func select_taps)
+/*
+ * The ladder, written once and inlined into a kernel for each output mode with and without
+ * saturation.  The mode and saturation are constants in each copy so the tap selection and
+ * the saturation test are resolved at compile time rather than per sample.
+ */
+static inline __attribute__((always_inline)) void ladder_render(struct filter *filter, size_t block_size, enum filter_type type, bool saturated)
 {
-  RTT_ASSERT(filter != NULL);
-  RTT_ASSERT(filter->samples != NULL);
-  RTT_ASSERT(filter->modulators != NULL);
-  RTT_ASSERT(select_taps != NULL);
-
   /* Stack cache variables */
-  float alpha0 = filter->alpha0;
   float resonance = filter->resonance_param;
   float saturate = filter->saturation_param;
 
@@ -169,87 +241,196 @@ static void internal_filter_render(struct filter * filter, size_t block_size, ou
   float z3 = filter->f3.z1;
   float z4 = filter->f4.z1;
 
-  float alpha1 = filter->f1.alpha;
-  float alpha2 = filter->f2.alpha;
-  float alpha3 = filter->f3.alpha;
-  float alpha4 = filter->f4.alpha;
-
-  float beta1 = filter->f1.beta;
-  float beta2 = filter->f2.beta;
-  float beta3 = filter->f3.beta;
-  float beta4 = filter->f4.beta;
+  float position_step;
+  float position = filter_ramp(filter, block_size, &position_step);
 
   float *restrict ptr = filter->samples;
   float *restrict end = ptr + block_size;
 
   while (ptr < end)
   {
-    float sigma = beta1 * z1 + beta2 * z2 + beta3 * z3 + beta4 * z4;    
-    float U=0;
+    size_t count = (end - ptr) < FILTER_SUB_BLOCK ? (size_t)(end - ptr) : FILTER_SUB_BLOCK;
+    float *restrict sub_end = ptr + count;
 
-#ifdef SATURATION_TANH_APPROX    
-    U = *ptr - resonance * sigma * alpha0;  
-    if (saturate > 0)
+    position += position_step;
+
+    struct filter_table_entry coeffs = filter_lookup(filter_modulate(filter, position, ptr - filter->samples));
+    float G = coeffs.G;
+    float B = coeffs.B;
+
+    float alpha1 = G;
+    float alpha2 = G;
+    float alpha3 = G;
+    float alpha4 = G;
+
+    float beta4 = B;
+    float beta3 = G * beta4;
+    float beta2 = G * beta3;
+    float beta1 = G * beta2;
+
+    float gamma = G * G * G * G;
+    float alpha0 = 1.0f / (1.0f + resonance * gamma);
+
+    while (ptr < sub_end)
     {
-      U *= saturate;
-      U = U / (fabsf(2 * U) + 1.5f);
-    }
+      float sigma = beta1 * z1 + beta2 * z2 + beta3 * z3 + beta4 * z4;
+      float U = *ptr - resonance * sigma * alpha0;
+
+      if (saturated)
+      {
+#ifdef SATURATION_TANH_APPROX
+        U *= saturate;
+        U = U / (fabsf(2 * U) + 1.5f);
 #endif
 
 #ifdef SATURATION_TANH
-    U = *ptr - resonance * sigma * alpha0;  
-    if (saturate > 0)
-    {
-      float x = U * saturate;
-      float x2 = x * x;
-      U = x * (27.0f + x2) / (27.0f + 9.0f * x2);
-    }
+        float x = U * saturate;
+        float x2 = x * x;
+        U = x * (27.0f + x2) / (27.0f + 9.0f * x2);
 #endif
 
 #ifdef SATURATION_FEEDBACK
-    float fb = resonance * sigma * alpha0;
-    U = *ptr - fb;
-
-    if (saturate > 0)
-    {      
-      fb = fb * 1.2f; 
-      fb = fb / (1.0f + fabsf(0.5f * fb));
-      U = *ptr - resonance * fb * alpha0;
+        float fb = resonance * sigma * alpha0;
+        fb = fb * 1.2f;
+        fb = fb / (1.0f + fabsf(0.5f * fb));
+        U = *ptr - resonance * fb * alpha0;
+#endif
+      }
+
+      float vn = (U - z1) * alpha1;
+      float lpf1 = vn + z1;
+      z1 = vn + lpf1;
+
+      vn = (lpf1 - z2) * alpha2;
+      float lpf2 = vn + z2;
+      z2 = vn + lpf2;
+
+      vn = (lpf2 - z3) * alpha3;
+      float lpf3 = vn + z3;
+      z3 = vn + lpf3;
+
+      vn = (lpf3 - z4) * alpha4;
+      float lpf4 = vn + z4;
+      z4 = vn + lpf4;
+
+      *ptr++ = ladder_output(type, U, lpf1, lpf2, lpf3, lpf4);
+    }
+  }
+
+  filter->f1.z1 = denormal_flush(z1);
+  filter->f2.z1 = denormal_flush(z2);
+  filter->f3.z1 = denormal_flush(z3);
+  filter->f4.z1 = denormal_flush(z4);
+}
+
+/* State variable filter outputs, as for the ladder the mode is a constant in each kernel */
+static inline __attribute__((always_inline)) float svf_output(enum filter_type type, float v0, float band, float low, float k)
+{
+  switch (type)
+  {
+  case FILTER_SVF_LP:
+    return low;
+  case FILTER_SVF_BP:
+    return band;
+  case FILTER_SVF_HP:
+    return v0 - k * band - low;
+  case FILTER_SVF_NOTCH:
+  default:
+    return v0 - k * band;
+  }
+}
+
+/*
+ * Zero delay feedback state variable filter (Andrew Simper's trapezoidal integrator form), a
+ * 2 pole filter giving all its outputs from one update.  It is much cheaper than the ladder
+ * and stays stable up to the top of the range, the saturation control does not apply.
+ */
+static inline __attribute__((always_inline)) void svf_render(struct filter *filter, size_t block_size, enum filter_type type)
+{
+  /* Resonance sets the damping, high resonance is low damping */
+  float k = FILTER_SVF_K_MAX - (FILTER_SVF_K_MAX - FILTER_SVF_K_MIN) * (filter->resonance_param / FILTER_RES_MAX);
+
+  float ic1eq = filter->ic1eq;
+  float ic2eq = filter->ic2eq;
+
+  float position_step;
+  float position = filter_ramp(filter, block_size, &position_step);
+
+  float *restrict ptr = filter->samples;
+  float *restrict end = ptr + block_size;
+
+  while (ptr < end)
+  {
+    size_t count = (end - ptr) < FILTER_SUB_BLOCK ? (size_t)(end - ptr) : FILTER_SUB_BLOCK;
+    float *restrict sub_end = ptr + count;
+
+    position += position_step;
+
+    float g = filter_lookup(filter_modulate(filter, position, ptr - filter->samples)).g;
+    float a1 = 1.0f / (1.0f + g * (g + k));
+    float a2 = g * a1;
+    float a3 = g * a2;
+
+#pragma GCC unroll 4
+    while (ptr < sub_end)
+    {
+      float v0 = *ptr;
+      float v3 = v0 - ic2eq;
+      float band = a1 * ic1eq + a2 * v3;
+      float low = ic2eq + a2 * ic1eq + a3 * v3;
+
+      ic1eq = 2.0f * band - ic1eq;
+      ic2eq = 2.0f * low - ic2eq;
+
+      *ptr++ = svf_output(type, v0, band, low, k);
     }
-#endif    
-    
-    float vn = (U - z1) * alpha1;
-    float lpf1 = vn + z1;
-    z1 = vn + lpf1;
-
-    vn = (lpf1 - z2) * alpha2;
-    float lpf2 = vn + z2;
-    z2 = vn + lpf2;
-
-    vn = (lpf2 - z3) * alpha3;
-    float lpf3 = vn + z3;
-    z3 = vn + lpf3;
-
-    vn = (lpf3 - z4) * alpha4;
-    float lpf4 = vn + z4;
-    z4 = vn + lpf4;
-    
-    select_taps(ptr++, U, lpf1, lpf2, lpf3, lpf4);
   }
 
-  filter->f1.z1 = z1;
-  filter->f2.z1 = z2;
-  filter->f3.z1 = z3;
-  filter->f4.z1 = z4;
+  filter->ic1eq = denormal_flush(ic1eq);
+  filter->ic2eq = denormal_flush(ic2eq);
 }
 
-static const struct jump_table_entry filter_funcs[] = {
-    {internal_filter_render, output_lpf2},
-    {internal_filter_render, output_bpf2},
-    {internal_filter_render, output_hpf2},
-    {internal_filter_render, output_lpf4},
-    {internal_filter_render, output_bpf4},
-    {internal_filter_render, output_hpf4}};
+#define SVF_KERNEL(name, type)                                   \
+  static void name(struct filter *filter, size_t block_size)     \
+  {                                                              \
+    svf_render(filter, block_size, type);                        \
+  }
+
+#define LADDER_KERNEL(name, type, saturated)                      \
+  static void name(struct filter *filter, size_t block_size)     \
+  {                                                              \
+    ladder_render(filter, block_size, type, saturated);          \
+  }
+
+LADDER_KERNEL(ladder_lpf2, FILTER_LPF2, false)
+LADDER_KERNEL(ladder_bpf2, FILTER_BPF2, false)
+LADDER_KERNEL(ladder_hpf2, FILTER_HPF2, false)
+LADDER_KERNEL(ladder_lpf4, FILTER_LPF4, false)
+LADDER_KERNEL(ladder_bpf4, FILTER_BPF4, false)
+LADDER_KERNEL(ladder_hpf4, FILTER_HPF4, false)
+LADDER_KERNEL(ladder_lpf2_sat, FILTER_LPF2, true)
+LADDER_KERNEL(ladder_bpf2_sat, FILTER_BPF2, true)
+LADDER_KERNEL(ladder_hpf2_sat, FILTER_HPF2, true)
+LADDER_KERNEL(ladder_lpf4_sat, FILTER_LPF4, true)
+LADDER_KERNEL(ladder_bpf4_sat, FILTER_BPF4, true)
+LADDER_KERNEL(ladder_hpf4_sat, FILTER_HPF4, true)
+SVF_KERNEL(svf_lp, FILTER_SVF_LP)
+SVF_KERNEL(svf_bp, FILTER_SVF_BP)
+SVF_KERNEL(svf_hp, FILTER_SVF_HP)
+SVF_KERNEL(svf_notch, FILTER_SVF_NOTCH)
+
+/* Filter kernel jump table, indexed by mode then whether the saturation is on */
+static void (*const filter_funcs[FILTER_TYPE_MAX][2])(struct filter *filter, size_t block_size) = {
+    {ladder_lpf2, ladder_lpf2_sat},
+    {ladder_bpf2, ladder_bpf2_sat},
+    {ladder_hpf2, ladder_hpf2_sat},
+    {ladder_lpf4, ladder_lpf4_sat},
+    {ladder_bpf4, ladder_bpf4_sat},
+    {ladder_hpf4, ladder_hpf4_sat},
+    {svf_lp, svf_lp},
+    {svf_bp, svf_bp},
+    {svf_hp, svf_hp},
+    {svf_notch, svf_notch}};
 
 void filter_render(struct filter * filter, size_t block_size)
 {
@@ -257,31 +438,63 @@ void filter_render(struct filter * filter, size_t block_size)
   RTT_ASSERT(filter->samples != NULL);
   RTT_ASSERT(filter->modulators != NULL);  
 
-  filter_calculate_coefficients(filter);
-  filter_funcs[filter->filter_type_param].filter(filter, block_size, filter_funcs[filter->filter_type_param].output);
+  filter->audio_mod = filter->mod_samples[filter->mod_source_param];
+
+  filter_funcs[filter->filter_type_param][filter->saturation_param > 0.0f](filter, block_size);
+}
+
+/**
+ * filter_set_oversample
+ * \brief Sets the render rate, coefficients are read from lower in the table
+ * \param filter the filter instance
+ * \param factor multiple of the sample rate
+ */
+void filter_set_oversample(struct filter *filter, uint8_t factor)
+{
+  RTT_ASSERT(filter != NULL);
+  RTT_ASSERT(factor > 0 && factor <= 2);
+
+  filter->rate_octaves = log2f((float)factor);
+  filter->rate_shift = factor > 1 ? 1 : 0;
 }
 
 void filter_update_params(struct filter *filter, float mode, float cutoff, float resonance,
-                                float saturation, float mod_depth, float mod_source, float note_tracking)
+                                float saturation, float mod_depth, float mod_source, float note_tracking,
+                                float velocity_tracking)
 {
   RTT_ASSERT(filter != NULL);
 
   filter->filter_type_param = PARAM_TO_INT(mode, 0, FILTER_TYPE_MAX-1);
-  filter->cutoff_param = PARAM_TO_EXP(cutoff, FILTER_CUT_MIN, FILTER_CUT_MAX);  
+  filter->cutoff_param = log2f(PARAM_TO_EXP(cutoff, FILTER_CUT_MIN, FILTER_CUT_MAX) / FILTER_CUT_MIN);
   filter->resonance_param = PARAM_TO_LINEAR(resonance, FILTER_RES_MIN, FILTER_RES_MAX);
   filter->saturation_param = PARAM_TO_LINEAR(saturation, FILTER_SAT_MIN, FILTER_SAT_MAX);
   filter->note_tracking_param = note_tracking;
+  filter->velocity_tracking_param = velocity_tracking;
   
   filter->mod_depth_param = mod_depth;
-  filter->mod_source_param = mod_source;  
+  filter->mod_source_param = PARAM_TO_INT(mod_source, MOD_LFO_TRIANGLE, MOD_MAX_SOURCE-1);
 }
 
-void filter_note_on(struct filter *filter, uint8_t note)
+/*
+ * Tracking is an offset to the cutoff exponent worked out once per note, the render adds it
+ * to the cutoff octaves along with the modulation so there is no extra per-sample cost.
+ */
+void filter_note_on(struct filter *filter, uint8_t note, uint8_t velocity)
 {
   RTT_ASSERT(filter != NULL);
 
+  float octaves = 0.0f;
+
   if (filter->note_tracking_param)
   {
-    
+    octaves += (note - FILTER_TRACK_NOTE) / 12.0f;
   }
+
+  if (filter->velocity_tracking_param)
+  {
+    octaves -= (1.0f - velocity / 127.0f) * FILTER_VEL_OCTAVES;
+  }
+
+  filter->note = note;
+  filter->track_octaves = octaves;
 }
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include "trace.h"
 
 #include "params.h"
+#include "mod_matrix.h"
 #include "dsp_core.h"
 #include "dsp_math.h"
 
@@ -36,11 +37,11 @@ enum filter_tap_col
   E_TAP
 };
 
+/* Coefficients are refreshed at this interval (samples), the cutoff is ramped between blocks */
+#define FILTER_SUB_BLOCK (16)
+
 struct sub_filter
 {
-  float alpha;
-  float beta;
-  float a0;
   float z1;
 };
 
@@ -50,34 +51,46 @@ struct filter
   /* Buffers */
   float *samples;
   float *modulators;
+  const float *const *mod_samples; /* Per-sample modulation at the base rate, NULL where block rate */
+  const struct mod_matrix *matrix;
 
   /* User parameters */
   enum filter_type filter_type_param;
-  float cutoff_param;
+  float cutoff_param; /* Octaves above FILTER_CUT_MIN */
   float resonance_param;
   float saturation_param;
 
   enum mod_source mod_source_param;
   float mod_depth_param;
   bool note_tracking_param;
+  bool velocity_tracking_param;
   
   /* Private data */
   float fsr;
-  float cutoff;
+  float rate_octaves;  /* Render rate above fsr (octaves), shifts the coefficient table */
+  uint8_t rate_shift;  /* Render samples per base rate sample (log2) */
+  const float *audio_mod; /* Per-sample source for this block, NULL for a block rate source */
+  float cutoff_octaves; /* Cutoff above FILTER_CUT_MIN (octaves) reached at the end of the last block */
+  bool cutoff_valid;
+  float track_octaves; /* Key and velocity tracking offset set at note on */
   float resonance;
   float bass_comp;
-  float alpha0;
   uint8_t note;
 
   /* Filter cascade */
   struct sub_filter f1, f2, f3, f4;
+
+  /* State variable filter integrators */
+  float ic1eq, ic2eq;
 };
 
-void filter_init(struct filter *filter, float fsr, float *samples, float *modulators);
+void filter_init(struct filter *filter, float fsr, float *samples, float *modulators, const float *const *mod_samples, const struct mod_matrix *matrix);
 void filter_reset(struct filter *filter);
-void filter_note_on(struct filter *filter, uint8_t note);
+void filter_note_on(struct filter *filter, uint8_t note, uint8_t velocity);
 void filter_render(struct filter *filter, size_t block_size);
+void filter_set_oversample(struct filter *filter, uint8_t factor);
 void filter_update_params(struct filter *filter, float mode, float cutoff, float resonance,
-  float saturation, float mod_depth, float mod_source, float note_tracking);
+  float saturation, float mod_depth, float mod_source, float note_tracking,
+  float velocity_tracking);
 
 #endif /* __FILTER_H__ */
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#include "governor.h"
+
+static inline float smooth_cost(float average, float measured)
+{
+  float coeff = (measured > average) ? GOVERNOR_COST_ATTACK : GOVERNOR_COST_DECAY;
+  return average + coeff * (measured - average);
+}
+
+/**
+ * governor_init
+ * \brief Sets up the CPU governor that limits polyphony to what can be rendered in time
+ * \param governor the governor instance
+ * \param fsr the sample rate
+ * \param block_size the number of samples rendered per block
+ * \param max_voices the number of voices the synth has
+ */
+void governor_init(struct governor *governor, float fsr, size_t block_size, uint8_t max_voices)
+{
+  RTT_ASSERT(governor);
+
+  cpu_clock_init();
+
+  governor->budget = (block_size / fsr) * CPU_CLOCK_TICKS_PER_SECOND * GOVERNOR_LOAD_LIMIT;
+  governor->voice_cost = 0.0f;
+  governor->overhead = 0.0f;
+  governor->max_voices = max_voices;
+  governor->voice_limit = max_voices;
+  governor->block_start = 0;
+  governor->voices_start = 0;
+  governor->voices_end = 0;
+}
+
+/**
+ * governor_update
+ * \brief Updates the cost estimates from the block just rendered and recalculates the voice limit
+ * \note Call at the end of the block, after the mixer.
+ * \param governor the governor instance
+ * \param active_voices the number of voices that rendered during the block, including any being shut down
+ */
+void governor_update(struct governor *governor, uint8_t active_voices)
+{
+  RTT_ASSERT(governor);
+
+  uint32_t block_end = cpu_clock_ticks();
+
+  /* The shared work before the voices and the mixer after them cost the same however many sound */
+  uint32_t overhead = (governor->voices_start - governor->block_start) + (block_end - governor->voices_end);
+  governor->overhead = smooth_cost(governor->overhead, (float)overhead);
+
+  /* Idle voices return immediately so the voice time is shared by the voices that rendered */
+  if (active_voices > 0)
+  {
+    float voice_cost = (float)(governor->voices_end - governor->voices_start) / active_voices;
+    governor->voice_cost = smooth_cost(governor->voice_cost, voice_cost);
+  }
+
+  if (governor->voice_cost <= 0.0f)
+  {
+    governor->voice_limit = governor->max_voices;
+    return;
+  }
+
+  float available = (governor->budget - governor->overhead) / governor->voice_cost;
+
+  if (available >= governor->max_voices)
+  {
+    governor->voice_limit = governor->max_voices;
+  }
+  else
+  {
+    /* Always allow one voice, anything less is silence */
+    governor->voice_limit = (available < 1.0f) ? 1 : (uint8_t)available;
+  }
+}
+
+/**
+ * governor_overloaded
+ * \brief Checks whether rendering the given number of voices is projected to exceed the budget
+ * \param governor the governor instance
+ * \param active_voices the number of voices that will sound in the next block
+ */
+bool governor_overloaded(struct governor *governor, uint8_t active_voices)
+{
+  RTT_ASSERT(governor);
+
+  return active_voices > governor->voice_limit;
+}
@@ -0,0 +1,78 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cpu_clock.h"
+#include "trace.h"
+
+/*
+ * Fraction of the block period the synth is allowed to use for rendering, the remainder is
+ * left for the DAE (MIDI, buffer conversion) and the other tasks.
+ */
+#ifndef GOVERNOR_LOAD_LIMIT
+#define GOVERNOR_LOAD_LIMIT (0.8f)
+#endif
+
+/* Smoothing of the measured costs, rises are followed quickly so overloads are caught early */
+#define GOVERNOR_COST_ATTACK (0.25f)
+#define GOVERNOR_COST_DECAY (0.05f)
+
+struct governor
+{
+  /* Ticks available to render one block */
+  float budget;
+
+  /* Smoothed cost, in ticks, of one sounding voice and of the fixed per-block work before and after the voices */
+  float voice_cost;
+  float overhead;
+
+  /* Number of voices that can be allocated without exceeding the budget */
+  uint8_t voice_limit;
+  uint8_t max_voices;
+
+  /* Timestamps for the block being measured */
+  uint32_t block_start;
+  uint32_t voices_start;
+  uint32_t voices_end;
+};
+
+void governor_init(struct governor *governor, float fsr, size_t block_size, uint8_t max_voices);
+void governor_update(struct governor *governor, uint8_t active_voices);
+bool governor_overloaded(struct governor *governor, uint8_t active_voices);
+
+/* Marks the start of the block, before the shared per-block work (tempo, shared LFO) */
+static inline void governor_block_start(struct governor *governor)
+{
+  governor->block_start = cpu_clock_ticks();
+}
+
+/* Marks the point where the shared work ends and voice rendering starts */
+static inline void governor_voices_start(struct governor *governor)
+{
+  governor->voices_start = cpu_clock_ticks();
+}
+
+/* Marks the point where voice rendering ends and the mixer starts */
+static inline void governor_voices_end(struct governor *governor)
+{
+  governor->voices_end = cpu_clock_ticks();
+}
+
+#endif /* __GOVERNOR_H__ */
@@ -16,6 +16,24 @@
 #define LFO_PHASE_MAX 1.0f
 #define LFO_PHASE_HALF 0.5f
 
+/* Cycles per beat when tempo synced, from one per 4 bars to 32nd notes */
+static const float lfo_sync_rates[] =
+    {1.0f / 16.0f, 1.0f / 8.0f, 1.0f / 6.0f, 1.0f / 4.0f, 1.0f / 3.0f, 1.0f / 2.0f, 2.0f / 3.0f, 1.0f,
+     4.0f / 3.0f, 3.0f / 2.0f, 2.0f, 8.0f / 3.0f, 3.0f, 4.0f, 6.0f, 8.0f};
+
+#define LFO_SYNC_DIVISIONS (sizeof(lfo_sync_rates) / sizeof(lfo_sync_rates[0]))
+
+/* The increment is worked out from the tempo when synced */
+static inline void lfo_set_rate(struct lfo *lfo)
+{
+    if (lfo->tempo_sync)
+    {
+        lfo->rate_param = lfo->bpm * lfo->cycles_per_beat / 60.0f;
+    }
+
+    lfo->inc = lfo->rate_param / lfo->fsr;
+}
+
 static inline void lfo_triangle(struct lfo *lfo, float phase)
 {
     lfo->modulators[MOD_LFO_TRIANGLE] = 4.0f * (float)fabsf(phase - 0.5f) - 1.0f;
@@ -38,12 +56,9 @@ static inline void lfo_square(struct lfo *lfo, float phase)
 
 static inline void lfo_sample_and_hold(struct lfo *lfo, size_t block_size)
 {
-    static uint32_t rand_state = 2463534242; /* Seed for XORShift RNG */
-    
     if (lfo->phase < lfo->prev_phase)
     {
-        uint32_t random_int = xorshift32(&rand_state);
-        lfo->sh_value = (float)random_int / (float)UINT32_MAX * 2.0f - 1.0f;
+        lfo->sh_value = random_to_bipolar(xorshift32(&lfo->rand_state));
     }
 
     lfo->modulators[MOD_LFO_SANDH] = lfo->sh_value;
@@ -51,15 +66,93 @@ static inline void lfo_sample_and_hold(struct lfo *lfo, size_t block_size)
     lfo->prev_phase = lfo->phase;
 }
 
-void lfo_init(struct lfo *lfo, float fsr, float *modulators)
+/*
+ * PolyBLEP residual for a unit step at phase 0, rounds off the square and saw edges at audio
+ * rates where a hard step would alias into whatever the LFO is modulating.
+ */
+static inline float lfo_blep(float phase, float inc)
+{
+    if (phase < inc)
+    {
+        float t = phase / inc;
+        return t + t - t * t - 1.0f;
+    }
+    else if (phase > LFO_PHASE_MAX - inc)
+    {
+        float t = (phase - LFO_PHASE_MAX) / inc;
+        return t * t + t + t + 1.0f;
+    }
+    return 0.0f;
+}
+
+/*
+ * Audio range, every waveform is rendered per sample into its own block and published on the
+ * bus.  The block rate modulators keep the value at the start of the block for destinations
+ * that only read once per block.
+ */
+static void lfo_render_audio(struct lfo *lfo, size_t block_size)
+{
+    float *restrict triangle = lfo->samples;
+    float *restrict saw = triangle + block_size;
+    float *restrict rev_saw = saw + block_size;
+    float *restrict square = rev_saw + block_size;
+    float *restrict sandh = square + block_size;
+
+    float phase = lfo->phase;
+    float inc = lfo->inc;
+    float sh_value = lfo->sh_value;
+
+    for (size_t i = 0; i < block_size; i++)
+    {
+        float half = phase + LFO_PHASE_HALF;
+        half -= half >= LFO_PHASE_MAX ? LFO_PHASE_MAX : 0.0f;
+
+        float blep = lfo_blep(phase, inc);
+        float ramp = 2.0f * phase - 1.0f - blep;
+
+        triangle[i] = 4.0f * fabsf(phase - 0.5f) - 1.0f;
+        saw[i] = ramp;
+        rev_saw[i] = -ramp;
+        square[i] = (phase < LFO_PHASE_HALF ? 1.0f : -1.0f) + blep - lfo_blep(half, inc);
+        sandh[i] = sh_value;
+
+        phase += inc;
+        if (phase >= LFO_PHASE_MAX)
+        {
+            phase -= LFO_PHASE_MAX;
+            sh_value = random_to_bipolar(xorshift32(&lfo->rand_state));
+        }
+    }
+
+    for (size_t w = 0; w < LFO_WAVES; w++)
+    {
+        lfo->modulators[MOD_LFO_TRIANGLE + w] = lfo->samples[w * block_size];
+        lfo->mod_samples[MOD_LFO_TRIANGLE + w] = lfo->samples + w * block_size;
+    }
+
+    lfo->phase = phase;
+    lfo->prev_phase = phase;
+    lfo->sh_value = sh_value;
+}
+
+void lfo_init(struct lfo *lfo, float fsr, float *modulators, const float **mod_samples, float *samples, uint32_t seed)
 {
     RTT_ASSERT(lfo != NULL);
     RTT_ASSERT(modulators != NULL);
+    RTT_ASSERT(mod_samples != NULL);
+    RTT_ASSERT(samples != NULL);
 
     lfo->fsr = fsr;
+    lfo->bpm = LFO_DEFAULT_BPM;
+    lfo->cycles_per_beat = 1.0f;
+    lfo->range_param = LFO_RANGE_LOW;
+    lfo->tempo_sync = false;
     lfo->modulators = modulators;
+    lfo->mod_samples = mod_samples;
+    lfo->samples = samples;
     lfo->hold_time = -1;
     lfo->sh_value = 0.0f;
+    lfo->rand_state = seed ? seed : 1; /* Each voice has its own XORShift sequence */
 
     lfo_reset(lfo);
 }
@@ -76,6 +169,17 @@ void lfo_render(struct lfo *lfo, size_t block_size)
     RTT_ASSERT(lfo != NULL);
     RTT_ASSERT(lfo->modulators != NULL);
 
+    if (lfo->range_param == LFO_RANGE_AUDIO)
+    {
+        lfo_render_audio(lfo, block_size);
+        return;
+    }
+
+    for (size_t w = 0; w < LFO_WAVES; w++)
+    {
+        lfo->mod_samples[MOD_LFO_TRIANGLE + w] = NULL;
+    }
+
     float next_phase = fmodf(lfo->phase + (lfo->inc * (float)block_size), 1.0f);
 
     lfo_triangle(lfo, lfo->phase);
@@ -87,13 +191,71 @@ void lfo_render(struct lfo *lfo, size_t block_size)
     lfo->phase = next_phase;
 }
 
-void lfo_update_params(struct lfo *lfo, float rate, float trigger_mode)
+/**
+ * lfo_update_params
+ * \brief Sets the rate, trigger mode, range and tempo sync
+ * \param lfo the LFO instance
+ * \param rate the rate, or the note division when synced
+ * \param trigger_mode free running or restarted by each note
+ * \param range low (block rate) or audio (per sample)
+ * \param sync rate as a division of the tempo (0.0=off, 1.0=on), in either range
+ */
+void lfo_update_params(struct lfo *lfo, float rate, float trigger_mode, float range, float sync)
 {
     RTT_ASSERT(lfo != NULL);
 
-    lfo->rate_param = PARAM_TO_LINEAR(rate,LFO_MIN_RATE, LFO_MAX_RATE); 
-    lfo->trigger_mode_param = trigger_mode;
-    lfo->inc = lfo->rate_param / lfo->fsr;    
+    lfo->range_param = PARAM_TO_INT(range, 0, LFO_RANGE_MAX-1);
+    lfo->trigger_mode_param = PARAM_TO_INT(trigger_mode, 0, LFO_MODE_MAX-1);
+    lfo->tempo_sync = PARAM_TO_INT(sync, SWITCH_OFF, SWITCH_MAX-1);
+
+    /* A synced rate is the same division whichever range renders it */
+    if (lfo->tempo_sync)
+    {
+        lfo->cycles_per_beat = lfo_sync_rates[PARAM_TO_INT(rate, 0, (int)LFO_SYNC_DIVISIONS - 1)];
+    }
+    else if (lfo->range_param == LFO_RANGE_AUDIO)
+    {
+        lfo->rate_param = PARAM_TO_EXP(rate, LFO_AUDIO_MIN_RATE, LFO_AUDIO_MAX_RATE);
+    }
+    else
+    {
+        lfo->rate_param = PARAM_TO_LINEAR(rate,LFO_MIN_RATE, LFO_MAX_RATE); 
+    }
+
+    lfo_set_rate(lfo);
+}
+
+/**
+ * lfo_set_tempo
+ * \brief Sets the tempo the synced rates are divisions of
+ * \param lfo the LFO instance
+ * \param bpm the tempo in beats per minute
+ */
+void lfo_set_tempo(struct lfo *lfo, float bpm)
+{
+    RTT_ASSERT(lfo != NULL);
+    RTT_ASSERT(bpm > 0.0f);
+
+    lfo->bpm = bpm;
+    lfo_set_rate(lfo);
+}
+
+/*
+ * A free running LFO is the same curve for every voice, so the synth renders one and each
+ * voice takes a copy of its waveforms rather than rendering its own.  Per-sample waveforms
+ * are shared by pointer.
+ */
+void lfo_share(const struct lfo *shared, float *modulators, const float **mod_samples)
+{
+    RTT_ASSERT(shared != NULL);
+    RTT_ASSERT(modulators != NULL);
+    RTT_ASSERT(mod_samples != NULL);
+
+    for (size_t w = MOD_LFO_TRIANGLE; w <= MOD_LFO_SANDH; w++)
+    {
+        modulators[w] = shared->modulators[w];
+        mod_samples[w] = shared->mod_samples[w];
+    }
 }
 
 void lfo_note_on(struct lfo *lfo)
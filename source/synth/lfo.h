@@ -30,31 +30,46 @@
 /* Ranges */
 #define LFO_MIN_RATE (0)
 #define LFO_MAX_RATE (20)
+#define LFO_AUDIO_MIN_RATE (10.0f)
+#define LFO_AUDIO_MAX_RATE (2000.0f)
+#define LFO_DEFAULT_BPM (120.0f)
+
+/* Waveforms rendered per sample in the audio range, one block each in source order */
+#define LFO_WAVES (MOD_LFO_SANDH - MOD_LFO_TRIANGLE + 1)
 
 struct lfo
 {
   /* Buffers */
   float *modulators;
+  const float **mod_samples; /* Per-sample sources, NULL where block rate */
+  float *samples;            /* LFO_WAVES * block_size */
 
   /* Parameters */
   float rate_param;
   enum lfo_trigger_mode trigger_mode_param;
+  enum lfo_range range_param;
+  bool tempo_sync;
+  float cycles_per_beat; /* Tempo synced rate */
   
   /* Private data */
   float phase;
   float inc;  
   float fsr;
+  float bpm;
   float hold_time;
   float sh_value;
   float prev_phase;
+  uint32_t rand_state;
 };
 
 
-void lfo_init(struct lfo *lfo, float fsr, float *modulators);
+void lfo_init(struct lfo *lfo, float fsr, float *modulators, const float **mod_samples, float *samples, uint32_t seed);
 void lfo_reset(struct lfo *lfo);
 void lfo_render(struct lfo *lfo, size_t block_size);
-void lfo_update_params(struct lfo *lfo, float rate, float trigger_mode);
+void lfo_update_params(struct lfo *lfo, float rate, float trigger_mode, float range, float sync);
 void lfo_note_on(struct lfo *lfo);
+void lfo_set_tempo(struct lfo *lfo, float bpm);
+void lfo_share(const struct lfo *shared, float *modulators, const float **mod_samples);
 
 
 #endif // __LFO_H
\ No newline at end of file
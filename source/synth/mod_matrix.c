@@ -0,0 +1,161 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#include "mod_matrix.h"
+
+/* Range of each destination at full amount */
+#define MOD_MATRIX_PITCH_RANGE (12.0f)
+#define MOD_MATRIX_PW_RANGE (0.5f)
+#define MOD_MATRIX_CUTOFF_RANGE (4.0f)
+#define MOD_MATRIX_AMP_RANGE (1.0f)
+#define MOD_MATRIX_PAN_RANGE (1.0f)
+
+/* The centre of the amount falls between two MIDI values, either side of it is off */
+#define MOD_MATRIX_DEADBAND (1.5f / 127.0f)
+
+struct mod_dest_entry
+{
+  enum mod_target first;
+  enum mod_target second; /* MOD_TARGET_MAX if only one */
+  float range;
+};
+
+/* Targets and range of each destination, in enum mod_dest order */
+static const struct mod_dest_entry mod_dest_table[MOD_DEST_MAX] =
+    {
+        {MOD_TARGET_MAX, MOD_TARGET_MAX, 0.0f},
+        {MOD_TARGET_OSC1_PITCH, MOD_TARGET_OSC2_PITCH, MOD_MATRIX_PITCH_RANGE},
+        {MOD_TARGET_OSC2_PITCH, MOD_TARGET_MAX, MOD_MATRIX_PITCH_RANGE},
+        {MOD_TARGET_PW, MOD_TARGET_MAX, MOD_MATRIX_PW_RANGE},
+        {MOD_TARGET_CUTOFF, MOD_TARGET_MAX, MOD_MATRIX_CUTOFF_RANGE},
+        {MOD_TARGET_AMP, MOD_TARGET_MAX, MOD_MATRIX_AMP_RANGE},
+        {MOD_TARGET_PAN, MOD_TARGET_MAX, MOD_MATRIX_PAN_RANGE}};
+
+/* Via for a slot without one */
+static const float mod_unity = 1.0f;
+
+static void mod_matrix_add_route(struct mod_matrix *matrix, enum mod_source source, const float *via, enum mod_target target, float amount)
+{
+  struct mod_route *route = &matrix->routes[matrix->route_count++];
+
+  route->source = &matrix->modulators[source];
+  route->samples = &matrix->mod_samples[source];
+  route->via = via;
+  route->target = target;
+  route->amount = amount;
+}
+
+/**
+ * mod_matrix_init
+ * \brief Sets up an empty modulation matrix
+ * \param matrix the matrix instance
+ * \param modulators the voice's block rate modulation sources
+ * \param mod_samples the voice's per-sample sources, NULL where block rate
+ */
+void mod_matrix_init(struct mod_matrix *matrix, const float *modulators, const float *const *mod_samples)
+{
+  RTT_ASSERT(matrix != NULL);
+  RTT_ASSERT(modulators != NULL);
+  RTT_ASSERT(mod_samples != NULL);
+
+  matrix->modulators = modulators;
+  matrix->mod_samples = mod_samples;
+  matrix->route_count = 0;
+  memset(matrix->targets, 0, sizeof(matrix->targets));
+  memset(matrix->audio_count, 0, sizeof(matrix->audio_count));
+}
+
+/**
+ * mod_matrix_render
+ * \brief Sums the routes into their targets, once per block
+ * \note A route from a source rendering at audio rate is passed to the module to sum per
+ *       sub-block.  The amp and pan are block rate only so such a route to them is left out
+ *       rather than stepping every block, the amp's own modulation follows it per sample.
+ * \param matrix the matrix instance
+ */
+void mod_matrix_render(struct mod_matrix *matrix)
+{
+  RTT_ASSERT(matrix != NULL);
+
+  /* With no routes the targets were left at zero when the patch changed */
+  if (matrix->route_count == 0)
+  {
+    return;
+  }
+
+  memset(matrix->targets, 0, sizeof(matrix->targets));
+  memset(matrix->audio_count, 0, sizeof(matrix->audio_count));
+
+  const struct mod_route *route = matrix->routes;
+  const struct mod_route *end = route + matrix->route_count;
+
+  while (route < end)
+  {
+    float amount = *route->via * route->amount;
+
+    if (*route->samples == NULL)
+    {
+      matrix->targets[route->target] += *route->source * amount;
+    }
+    else if (route->target < MOD_TARGET_AUDIO_MAX)
+    {
+      struct mod_audio_route *audio = &matrix->audio[route->target][matrix->audio_count[route->target]++];
+      audio->samples = *route->samples;
+      audio->amount = amount;
+    }
+
+    route++;
+  }
+}
+
+/**
+ * mod_matrix_update_params
+ * \brief Compiles the patch's slots into the route list, slots that are off are left out
+ * \param matrix the matrix instance
+ * \param slots MOD_MATRIX_SLOTS sets of source, destination, amount and via, normalised
+ */
+void mod_matrix_update_params(struct mod_matrix *matrix, const float *slots)
+{
+  RTT_ASSERT(matrix != NULL);
+  RTT_ASSERT(slots != NULL);
+
+  matrix->route_count = 0;
+  memset(matrix->targets, 0, sizeof(matrix->targets));
+  memset(matrix->audio_count, 0, sizeof(matrix->audio_count));
+
+  for (size_t i = 0; i < MOD_MATRIX_SLOTS; i++, slots += MOD_MATRIX_SLOT_PARAMS)
+  {
+    enum mod_source source = PARAM_TO_INT(slots[0], 0, MOD_MAX_SOURCE-1);
+    enum mod_dest dest = PARAM_TO_INT(slots[1], 0, MOD_DEST_MAX-1);
+    float amount = UNI_TO_BI(slots[2]);
+    int via = PARAM_TO_INT(slots[3], 0, MOD_MAX_SOURCE);
+
+    if (dest == MOD_DEST_OFF || fabsf(amount) < MOD_MATRIX_DEADBAND)
+    {
+      continue;
+    }
+
+    const struct mod_dest_entry *entry = &mod_dest_table[dest];
+
+    /* Via 0 is none, otherwise it is the source one below */
+    const float *via_source = via == 0 ? &mod_unity : &matrix->modulators[via - 1];
+
+    mod_matrix_add_route(matrix, source, via_source, entry->first, amount * entry->range);
+
+    if (entry->second != MOD_TARGET_MAX)
+    {
+      mod_matrix_add_route(matrix, source, via_source, entry->second, amount * entry->range);
+    }
+  }
+}
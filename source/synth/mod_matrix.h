@@ -0,0 +1,103 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+#ifndef __MOD_MATRIX_H__
+#define __MOD_MATRIX_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "trace.h"
+
+#include "params.h"
+#include "dsp_math.h"
+
+/* Slots in the patch, each is a source, destination, amount and via parameter */
+#define MOD_MATRIX_SLOTS (4)
+#define MOD_MATRIX_SLOT_PARAMS (4)
+
+/* A destination can feed more than one target, pitch drives both oscillators */
+#define MOD_MATRIX_ROUTES_MAX (MOD_MATRIX_SLOTS * 2)
+
+/* Values the routes sum into each block, read by the modules in their own units.  The targets
+   before MOD_TARGET_AUDIO_MAX are read in sub-blocks and can follow an audio rate source. */
+enum mod_target
+{
+  MOD_TARGET_OSC1_PITCH, /* Semitones */
+  MOD_TARGET_OSC2_PITCH, /* Semitones */
+  MOD_TARGET_PW,         /* Pulse width or table position */
+  MOD_TARGET_CUTOFF,     /* Octaves */
+  MOD_TARGET_AMP,        /* Gain, added to unity */
+  MOD_TARGET_PAN,        /* Stereo position, -1 left to 1 right */
+  MOD_TARGET_MAX
+};
+
+#define MOD_TARGET_AUDIO_MAX (MOD_TARGET_CUTOFF + 1)
+
+/* A compiled slot, the amount includes the destination's range */
+struct mod_route
+{
+  const float *source;
+  const float *const *samples; /* The source's per-sample block, NULL while it is block rate */
+  const float *via;
+  enum mod_target target;
+  float amount;
+};
+
+/* A route from a source rendering at audio rate, the amount includes the via's block value */
+struct mod_audio_route
+{
+  const float *samples;
+  float amount;
+};
+
+struct mod_matrix
+{
+  /* Buffers */
+  const float *modulators;
+  const float *const *mod_samples;
+
+  /* Routes for the slots in use, built when the patch changes */
+  struct mod_route routes[MOD_MATRIX_ROUTES_MAX];
+  uint8_t route_count;
+
+  /* Output */
+  float targets[MOD_TARGET_MAX];
+
+  /* Routes from audio rate sources, summed by the module per sub-block instead of per block */
+  struct mod_audio_route audio[MOD_TARGET_AUDIO_MAX][MOD_MATRIX_SLOTS];
+  uint8_t audio_count[MOD_TARGET_AUDIO_MAX];
+};
+
+/*
+ * Sum of the audio rate routes into a target at a sample of the block (at the base rate).
+ * Nothing to add unless an audio rate LFO is routed to the target.
+ */
+static inline float mod_matrix_audio(const struct mod_matrix *matrix, enum mod_target target, size_t index)
+{
+  float sum = 0.0f;
+
+  for (uint8_t i = 0; i < matrix->audio_count[target]; i++)
+  {
+    sum += matrix->audio[target][i].samples[index] * matrix->audio[target][i].amount;
+  }
+
+  return sum;
+}
+
+void mod_matrix_init(struct mod_matrix *matrix, const float *modulators, const float *const *mod_samples);
+void mod_matrix_render(struct mod_matrix *matrix);
+void mod_matrix_update_params(struct mod_matrix *matrix, const float *slots);
+
+#endif /* __MOD_MATRIX_H__ */
@@ -0,0 +1,144 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#include "noise.h"
+
+/* Scales the summed pink rows back to a similar loudness as the white noise */
+#define NOISE_PINK_SCALER (2.5f / (NOISE_PINK_ROWS + 1))
+
+static void ugen_white(struct noise *noise, size_t block_size);
+static void ugen_pink(struct noise *noise, size_t block_size);
+
+/* Noise generator jump table */
+static void (*noise_generator[NOISE_TYPE_MAX])(struct noise *noise, size_t block_size) =
+    {
+        ugen_white,
+        ugen_pink};
+
+/*
+ * Voss-McCartney pink noise, row n is refreshed every 2^n samples (picked by the trailing
+ * zeros of a counter) and the rows are summed with one white sample.  The top bit keeps the
+ * row index in range and the counter non-zero.
+ */
+static inline float pink_sample(struct pink *pink)
+{
+  uint32_t row = __builtin_ctz(++pink->counter | (1UL << (NOISE_PINK_ROWS - 1)));
+  float random = random_to_bipolar(xorshift32(&pink->state));
+
+  pink->row_sum += random - pink->rows[row];
+  pink->rows[row] = random;
+
+  return (pink->row_sum + random_to_bipolar(xorshift32(&pink->state))) * NOISE_PINK_SCALER;
+}
+
+static void pink_init(struct pink *pink, uint32_t seed)
+{
+  /* Xorshift must never be seeded with zero */
+  pink->state = seed ? seed : 1;
+  pink->counter = 0;
+  pink->row_sum = 0.0f;
+
+  for (int i = 0; i < NOISE_PINK_ROWS; i++)
+  {
+    pink->rows[i] = 0.0f;
+  }
+}
+
+void noise_init(struct noise *noise, float *samples, float *modulators, uint32_t seed, uint32_t mod_seed)
+{
+  RTT_ASSERT(noise != NULL);
+  RTT_ASSERT(samples != NULL);
+  RTT_ASSERT(modulators != NULL);
+
+  noise->samples = samples;
+  noise->modulators = modulators;
+  noise->type_param = NOISE_WHITE;
+  noise->level_param = 0.0f;
+
+  /* The modulator has its own generator, stepping the audio one would refresh every row
+     between two reads and leave a block rate sample and hold */
+  pink_init(&noise->audio, seed);
+  pink_init(&noise->mod, mod_seed);
+}
+
+/**
+ * noise_render
+ * \brief Mixes the noise source into the voice buffer
+ * \note The oscillators have already written the buffer so this always accumulates.
+ * \param noise the noise instance
+ * \param block_size the number of samples to render
+ */
+void noise_render(struct noise *noise, size_t block_size)
+{
+  RTT_ASSERT(noise != NULL);
+
+  if (noise->level_param == 0.0f)
+  {
+    return;
+  }
+
+  noise_generator[noise->type_param](noise, block_size);
+}
+
+/**
+ * noise_render_modulator
+ * \brief Steps the modulator's pink generator once per block to give a slowly wandering modulation source
+ * \note This is independent of the audio noise, its type and level have no effect on it.
+ * \param noise the noise instance
+ */
+void noise_render_modulator(struct noise *noise)
+{
+  RTT_ASSERT(noise != NULL);
+
+  noise->modulators[MOD_NOISE] = pink_sample(&noise->mod);
+}
+
+void noise_update_params(struct noise *noise, float type, float level)
+{
+  RTT_ASSERT(noise != NULL);
+
+  noise->type_param = PARAM_TO_INT(type, 0, NOISE_TYPE_MAX - 1);
+  noise->level_param = level * NOISE_GAIN_SCALER;
+}
+
+static void ugen_white(struct noise *noise, size_t block_size)
+{
+  float *restrict ptr = noise->samples;
+  float *restrict end = ptr + block_size;
+
+  uint32_t state = noise->audio.state;
+  float level = noise->level_param;
+
+#pragma GCC unroll 4
+  while (ptr < end)
+  {
+    *ptr++ += random_to_bipolar(xorshift32(&state)) * level;
+  }
+
+  noise->audio.state = state;
+}
+
+static void ugen_pink(struct noise *noise, size_t block_size)
+{
+  float *restrict ptr = noise->samples;
+  float *restrict end = ptr + block_size;
+
+  float level = noise->level_param;
+
+#pragma GCC unroll 4
+  while (ptr < end)
+  {
+    *ptr++ += pink_sample(&noise->audio) * level;
+  }
+}
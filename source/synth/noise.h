@@ -0,0 +1,61 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#ifndef __NOISE_H__
+#define __NOISE_H__
+
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+#include "params.h"
+#include "dsp_core.h"
+#include "dsp_math.h"
+
+/* Number of Voss-McCartney rows, each covers one octave of the pink spectrum */
+#define NOISE_PINK_ROWS (8)
+
+/* Voss-McCartney generator, the audio and the modulator each step their own */
+struct pink
+{
+  uint32_t state;
+  uint32_t counter;
+  float rows[NOISE_PINK_ROWS];
+  float row_sum;
+};
+
+struct noise
+{
+  /* Buffers */
+  float *samples;
+  float *modulators;
+
+  /* Parameters */
+  enum noise_type type_param;
+  float level_param;
+
+  /* Private data, each voice has its own generator state */
+  struct pink audio;
+  struct pink mod;
+};
+
+/* API */
+void noise_init(struct noise *noise, float *samples, float *modulators, uint32_t seed, uint32_t mod_seed);
+void noise_render(struct noise *noise, size_t block_size);
+void noise_render_modulator(struct noise *noise);
+void noise_update_params(struct noise *noise, float type, float level);
+
+#endif /* __NOISE_H__ */
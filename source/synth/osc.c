@@ -23,10 +23,31 @@
 #define OSC_CENTS_MAX (50)
 #define OSC_MOD_DEPTH_MIN (0.0f)
 #define OSC_MOD_DEPTH_MAX (5.0f)
+#define OSC_FM_INDEX_MAX (4.0f)
 
-static void ugen_saw(struct osc *osc, float *samples, size_t block_size);
-static void ugen_triangle(struct osc *osc, float *samples, size_t block_size);
-static void ugen_pulse(struct osc *osc, float *samples, size_t block_size);
+/* The phase increment is refreshed at this interval (samples) */
+#define OSC_SUB_BLOCK (16)
+
+static void ugen_saw_write(struct osc *osc, float *samples, size_t block_size);
+static void ugen_saw_mix(struct osc *osc, float *samples, size_t block_size);
+static void ugen_triangle_write(struct osc *osc, float *samples, size_t block_size);
+static void ugen_triangle_mix(struct osc *osc, float *samples, size_t block_size);
+static void ugen_pulse_write(struct osc *osc, float *samples, size_t block_size);
+static void ugen_pulse_mix(struct osc *osc, float *samples, size_t block_size);
+static void ugen_pwm_write(struct osc *osc, float *samples, size_t block_size);
+static void ugen_pwm_mix(struct osc *osc, float *samples, size_t block_size);
+static void ugen_wavetable_write(struct osc *osc, float *samples, size_t block_size);
+static void ugen_wavetable_mix(struct osc *osc, float *samples, size_t block_size);
+static void ugen_supersaw_write(struct osc *osc, float *samples, size_t block_size);
+static void ugen_supersaw_mix(struct osc *osc, float *samples, size_t block_size);
+static void ugen_fm_write(struct osc *osc, float *samples, size_t block_size);
+static void ugen_fm_mix(struct osc *osc, float *samples, size_t block_size);
+static float value_saw(struct osc *osc, float phase);
+static float value_triangle(struct osc *osc, float phase);
+static float value_pulse(struct osc *osc, float phase);
+static float value_wavetable(struct osc *osc, float phase);
+static void osc_sync_stream(struct osc *osc, float *sync, size_t count);
+static void osc_render_synced(struct osc *osc, float *samples, const float *sync, size_t count, bool has_previous);
 
 /* Adds a touch of analogue feel */
 static inline float soft_saturation(float x)
@@ -38,27 +59,181 @@ static inline float soft_saturation(float x)
 #endif  
 }
 
-/* Sound generator jump table */
-static void (*sound_generator[OSC_WAVE_MAX])(struct osc *osc, float *samples, size_t block_size) =
+/* Sound generator jump table, indexed by reset_buf (mix or write) then waveform */
+static void (*sound_generator[2][OSC_WAVE_MAX])(struct osc *osc, float *samples, size_t block_size) =
+    {
+        {ugen_triangle_mix,
+         ugen_saw_mix,
+         ugen_pulse_mix,
+         ugen_wavetable_mix,
+         ugen_supersaw_mix},
+        {ugen_triangle_write,
+         ugen_saw_write,
+         ugen_pulse_write,
+         ugen_wavetable_write,
+         ugen_supersaw_write}};
+
+static void (*fm_generator[2])(struct osc *osc, float *samples, size_t block_size) =
+    {
+        ugen_fm_mix,
+        ugen_fm_write};
+
+/* Pulse with the width moving per sample, only used while it is being modulated */
+static void (*pwm_generator[2])(struct osc *osc, float *samples, size_t block_size) =
+    {
+        ugen_pwm_mix,
+        ugen_pwm_write};
+
+/* Single sample waveform values, used to size the step when a synced oscillator resets */
+static float (*wave_value[OSC_WAVE_MAX])(struct osc *osc, float phase) =
     {
-        ugen_triangle,
-        ugen_saw,
-        ugen_pulse};
+        value_triangle,
+        value_saw,
+        value_pulse,
+        value_wavetable,
+        value_saw}; /* Supersaw, the step is sized from the centre saw */
+
+/* Wavetable position (0-1) used for each waveform under FM, the table is band-limited */
+static const float fm_position[OSC_WAVE_MAX] =
+    {
+        1.0f / (WT_FRAMES - 1), /* Triangle */
+        2.0f / (WT_FRAMES - 1), /* Saw */
+        3.0f / (WT_FRAMES - 1), /* Square */
+        0.0f,                   /* Wavetable, uses the table position */
+        2.0f / (WT_FRAMES - 1)  /* Supersaw */
+};
+
+/*
+ * Supersaw detune of each phase relative to the centre, and the starting phases.  The spread
+ * and the detune/mix curves follow Adam Szabo's measurements of the JP-8000.
+ */
+static const float supersaw_offset[OSC_SUPERSAW_PHASES] =
+    {0.0f, -0.11002313f, -0.06288439f, -0.01952356f, 0.01991221f, 0.06216538f, 0.10745242f};
+
+static const float supersaw_start[OSC_SUPERSAW_PHASES - 1] =
+    {0.618f, 0.236f, 0.854f, 0.472f, 0.090f, 0.708f};
+
+/* Detune amount from the control, fine near zero and rising steeply at the top */
+static inline float supersaw_detune(float x)
+{
+  static const float coeffs[] = {10028.7312891634f, -50818.8652045924f, 111363.4808729368f, -138150.6761080548f,
+                                 106649.6679158292f, -53046.9642751875f, 17019.9518580080f, -3425.0836591318f,
+                                 404.2703938388f, -24.1878824391f, 0.6717417634f, 0.0030115596f};
+  float y = 0.0f;
+
+  for (size_t i = 0; i < sizeof(coeffs) / sizeof(coeffs[0]); i++)
+  {
+    y = y * x + coeffs[i];
+  }
+
+  return y;
+}
+
+/* Level correction so narrow pulses are as loud as a square */
+static inline float pulse_correction(float pulse_width)
+{
+  return (pulse_width < 0.5f) ? 1.0f / (1.0f - pulse_width) : 1.0f / pulse_width;
+}
 
-void osc_init(struct osc *osc, float fsr, float *samples, float *modulators, bool reset_buf)
+/* Selects the kernel for the waveform, the cross modulation and whether the width is moving */
+static inline void (*osc_generator(struct osc *osc))(struct osc *osc, float *samples, size_t block_size)
+{
+  if (!osc->xmod_master && osc->xmod_mode == XMOD_FM)
+  {
+    return fm_generator[osc->reset_buf];
+  }
+
+  if (osc->wave_param == OSC_PULSE && osc->pw_step != 0.0f)
+  {
+    return pwm_generator[osc->reset_buf];
+  }
+
+  return sound_generator[osc->reset_buf][osc->wave_param];
+}
+
+/* Pitch offset (semitones) from the audio rate sources at a sample of the block */
+static inline float osc_audio_pitch(const struct osc *osc, const float *source, size_t index)
+{
+  float semitones = mod_matrix_audio(osc->matrix, osc->pitch_target, index);
+
+  return (source != NULL) ? semitones + osc->mod_depth_param * source[index] : semitones;
+}
+
+/* Pulse width at a render offset, the block rate width plus the audio rate sources there */
+static inline float osc_audio_pw(const struct osc *osc, const float *source, float pw, size_t offset, size_t last)
+{
+  size_t index = offset >> osc->rate_shift;
+  index = (index < last) ? index : last;
+
+  pw += mod_matrix_audio(osc->matrix, MOD_TARGET_PW, index);
+
+  if (source != NULL)
+  {
+    pw += osc->pwm_depth_param * source[index] * 0.5f;
+  }
+
+  return fminf(fmaxf(pw, 0.0f), 1.0f);
+}
+
+/* Wraps a phase that may have run outside 0-1 by up to a cycle either way */
+static inline float wrap_phase(float phase)
+{
+  phase -= (int)phase;
+  phase += (phase < 0.0f);
+  return phase - (int)phase;
+}
+
+/* Selects the mip level for the increment and the two frames either side of the position */
+static inline void wavetable_select(float inc, float position, const float **table_a, const float **table_b, float *fade)
+{
+  /* Octave of the increment relative to one table step selects the mip level */
+  int mip;
+  frexpf(inc * WT_LENGTH, &mip);
+  mip = (mip < 0) ? 0 : (mip > WT_LEVELS - 1) ? WT_LEVELS - 1 : mip;
+
+  /* Table position is between two adjacent frames */
+  position *= (WT_FRAMES - 1);
+  int frame = (int)position;
+  frame = (frame > WT_FRAMES - 2) ? WT_FRAMES - 2 : frame;
+
+  *fade = position - frame;
+  *table_a = wavetable[frame][mip];
+  *table_b = wavetable[frame + 1][mip];
+}
+
+void osc_init(struct osc *osc, float fsr, float *samples, float *modulators, const float *const *mod_samples, const struct mod_matrix *matrix, bool reset_buf)
 {
   RTT_ASSERT(osc != NULL);
   RTT_ASSERT(samples != NULL);
+  RTT_ASSERT(mod_samples != NULL);
+  RTT_ASSERT(matrix != NULL);
   
   osc->reset_buf = reset_buf;
   osc->fsr = fsr;
+  osc->oversample = 1.0f;
+  osc->rate_shift = 0;
   osc->phase = 0.0f;
   osc->inc = 0.0f;
   osc->pitch = 0.0f;
+  osc->glide = 0.0f;
+  osc->glide_rate = 0.0f;
+  osc->semitones = 0.0f;
+  osc->semitones_valid = false;
+  osc->xmod_master = reset_buf;
+  osc->xmod_mode = XMOD_OFF;
+  osc->xmod = NULL;
+  osc->fm_index = 0.0f;
   osc->samples = samples;   
   osc->modulators = modulators;
+  osc->mod_samples = mod_samples;
+  osc->matrix = matrix;
+  osc->pitch_target = reset_buf ? MOD_TARGET_OSC1_PITCH : MOD_TARGET_OSC2_PITCH;
   osc->wave_param = 0; 
   osc->pw_param = 0.5f;
+  osc->pwm_source_param = MOD_LFO_TRIANGLE;
+  osc->pwm_depth_param = 0.0f;
+  osc->pw = 0.5f;
+  osc->pw_step = 0.0f;
 
   osc_reset(osc);
 }
@@ -68,14 +243,14 @@ void osc_reset(struct osc *osc)
 {
   RTT_ASSERT(osc != NULL);
   osc->phase = (osc->wave_param == OSC_TRIANGLE) ? 0.5f : 0;
-}
 
-static inline __attribute__((const)) float pitch_shift_multiplier(float semi_tones)
-{
-  if (semi_tones == 0)
-    return 1.0f;
+  for (int i = 0; i < OSC_SUPERSAW_PHASES - 1; i++)
+  {
+    osc->super_phase[i] = supersaw_start[i];
+  }
 
-  return powf(2.0f, semi_tones / 12.0f);
+  osc->hp_x1 = 0.0f;
+  osc->hp_y1 = 0.0f;
 }
 
 
@@ -88,10 +263,97 @@ void osc_render(struct osc *osc, size_t block_size)
   {
     return;
   }
- 
-  osc->inc = osc->pitch * powf(2.0f, ((osc->mod_depth_param * osc->modulators[osc->mod_source_param]) + (float)(osc->octave_param * 12 + osc->semi_param) + (float)osc->cents_param * 0.01f) / 12.0f) / osc->fsr;
 
-  sound_generator[osc->wave_param](osc, osc->samples, block_size);
+  /* A source rendering at audio rate is read per sub-block below rather than ramped from its
+     block value, as are the matrix routes from one */
+  const float *pitch_source = osc->mod_samples[osc->mod_source_param];
+  const float *pw_source = osc->mod_samples[osc->pwm_source_param];
+  bool audio_pitch = pitch_source != NULL || osc->matrix->audio_count[osc->pitch_target] > 0;
+  bool audio_pw = pw_source != NULL || osc->matrix->audio_count[MOD_TARGET_PW] > 0;
+
+  float pitch_mod = (pitch_source == NULL) ? osc->mod_depth_param * osc->modulators[osc->mod_source_param] : 0.0f;
+  float semi_tones = pitch_mod + (float)(osc->octave_param * 12 + osc->semi_param) + (float)osc->cents_param * 0.01f + osc->matrix->targets[osc->pitch_target];
+
+  float pw_mod = (pw_source == NULL) ? osc->pwm_depth_param * osc->modulators[osc->pwm_source_param] * 0.5f : 0.0f;
+  float pw = osc->pw_param + pw_mod + osc->matrix->targets[MOD_TARGET_PW];
+  pw = fminf(fmaxf(pw, 0.0f), 1.0f);
+
+  /* A new note starts at its target rather than ramping from the previous note's modulation */
+  if (!osc->semitones_valid)
+  {
+    osc->semitones = semi_tones;
+    osc->pw = pw;
+    osc->semitones_valid = true;
+  }
+
+  /*
+   * The generator is run in sub-blocks, each with its own phase increment.  The block rate
+   * modulation is ramped linearly across the block and the glide stepped per sub-block, so
+   * vibrato and portamento move smoothly rather than stepping every block.  The increment
+   * stream uses the fast exp2 approximation rather than powf().
+   */
+  /* A master driving ring or FM is the modulator only, it renders into the shared buffer */
+  float *buffer = (osc->xmod_master && osc->xmod_mode >= XMOD_RING) ? osc->xmod : osc->samples;
+  bool sync_out = osc->xmod_master && osc->xmod_mode == XMOD_SYNC;
+  bool sync_in = !osc->xmod_master && osc->xmod_mode == XMOD_SYNC;
+
+  /* The pulse width is ramped per sample, the wavetable position per sub-block.  With an audio
+     rate source the ramp runs between its values at the start of each sub-block. */
+  float pw_start = osc->pw;
+  float pw_step = (pw - pw_start) / (float)block_size;
+  size_t last = (block_size >> osc->rate_shift) - 1;
+  osc->pw_step = pw_step;
+
+  void (*generator)(struct osc *osc, float *samples, size_t block_size) = osc_generator(osc);
+
+  float *ptr = buffer;
+  float *end = ptr + block_size;
+  float glide = osc->glide;
+  float glide_step = osc->glide_rate * OSC_SUB_BLOCK / osc->oversample;
+  float semitones = osc->semitones;
+  float semitone_step = (semi_tones - semitones) * OSC_SUB_BLOCK / (float)block_size;
+  float base_inc = osc->pitch / (osc->fsr * osc->oversample);
+
+  while (ptr < end)
+  {
+    size_t count = (end - ptr) < OSC_SUB_BLOCK ? (size_t)(end - ptr) : OSC_SUB_BLOCK;
+
+    size_t offset = (size_t)(ptr - buffer);
+    float audio_semitones = audio_pitch ? osc_audio_pitch(osc, pitch_source, offset >> osc->rate_shift) : 0.0f;
+
+    semitones += semitone_step;
+    osc->inc = base_inc * FAST_EXP2((semitones + glide + audio_semitones) * (1.0f / 12.0f));
+    osc->pw = pw_start + pw_step * (float)offset;
+
+    if (audio_pw)
+    {
+      float pw_end = osc_audio_pw(osc, pw_source, pw_start + pw_step * (float)(offset + count), offset + count, last);
+      osc->pw = osc_audio_pw(osc, pw_source, osc->pw, offset, last);
+      osc->pw_step = (pw_end - osc->pw) / (float)count;
+      generator = osc_generator(osc);
+    }
+
+    if (sync_out)
+    {
+      osc_sync_stream(osc, osc->xmod + (ptr - buffer), count);
+    }
+
+    if (sync_in)
+    {
+      osc_render_synced(osc, ptr, osc->xmod + (ptr - buffer), count, ptr > buffer);
+    }
+    else
+    {
+      generator(osc, ptr, count);
+    }
+
+    glide = (glide > 0.0f) ? fmaxf(glide - glide_step, 0.0f) : fminf(glide + glide_step, 0.0f);
+    ptr += count;
+  }
+
+  osc->semitones = semi_tones;
+  osc->pw = pw;
+  osc->glide = glide;
 }
 
 /**
@@ -107,6 +369,76 @@ void osc_note_on(struct osc *osc, float pitch)
 
   osc_reset(osc);
   osc->pitch = pitch;
+  osc->glide = 0.0f;
+  osc->semitones_valid = false;
+}
+
+/**
+ * osc_note_change
+ * \brief Changes the pitch of a sounding oscillator (legato)
+ * \note The phase is not reset so the waveform continues without a discontinuity.
+ * \param osc Pointer to the oscillator instance
+ * \param pitch The new pitch (Hz)
+ */
+void osc_note_change(struct osc *osc, float pitch)
+{
+  RTT_ASSERT(osc != NULL);
+
+  osc->pitch = pitch;
+  osc->glide = 0.0f;
+}
+
+/**
+ * osc_glide
+ * \brief Starts a portamento glide towards the current pitch
+ * \param osc Pointer to the oscillator instance
+ * \param semitones Starting offset from the current pitch (semitones)
+ * \param rate Glide rate in semitones per sample
+ */
+void osc_glide(struct osc *osc, float semitones, float rate)
+{
+  RTT_ASSERT(osc != NULL);
+
+  osc->glide = (rate > 0.0f) ? semitones : 0.0f;
+  osc->glide_rate = rate;
+}
+
+/**
+ * osc_xmod
+ * \brief Configures the cross modulation from OSC1 to OSC2
+ * \note In ring and FM modes OSC1 becomes the modulator and is not heard directly, its level
+ *       sets the amount of modulation.  In sync mode both oscillators are heard.
+ * \param osc Pointer to the oscillator instance
+ * \param mode The cross modulation mode
+ * \param xmod Shared per-sample buffer, written by OSC1 and read by OSC2
+ * \param depth Normalised depth, sets the FM index
+ */
+void osc_xmod(struct osc *osc, enum xmod_mode mode, float *xmod, float depth)
+{
+  RTT_ASSERT(osc != NULL);
+  RTT_ASSERT(xmod != NULL);
+
+  osc->xmod_mode = mode;
+  osc->xmod = xmod;
+  osc->fm_index = PARAM_TO_LINEAR(depth, 0.0f, OSC_FM_INDEX_MAX);
+
+  /* OSC2 is the first to write the voice buffer when OSC1 renders into the shared buffer */
+  osc->reset_buf = osc->xmod_master || mode == XMOD_RING || mode == XMOD_FM;
+}
+
+/**
+ * osc_set_oversample
+ * \brief Sets the render rate, block sizes passed to osc_render() are then in oversampled samples
+ * \param osc Pointer to the oscillator instance
+ * \param factor Multiple of the sample rate
+ */
+void osc_set_oversample(struct osc *osc, uint8_t factor)
+{
+  RTT_ASSERT(osc != NULL);
+  RTT_ASSERT(factor > 0);
+
+  osc->oversample = (float)factor;
+  osc->rate_shift = factor > 1 ? 1 : 0;
 }
 
 void osc_note_off(struct osc *osc)
@@ -115,7 +447,8 @@ void osc_note_off(struct osc *osc)
   osc->pitch = 0.0f;
 }
 
-void osc_update_params(struct osc *osc, float waveform, float octave, float semi, float cents,float level, float mod_source, float mod_depth, float pw)
+void osc_update_params(struct osc *osc, float waveform, float octave, float semi, float cents,float level, float mod_source, float mod_depth, float pw,
+                       float pwm_source, float pwm_depth)
 {
   RTT_ASSERT(osc != NULL);
   
@@ -126,155 +459,583 @@ void osc_update_params(struct osc *osc, float waveform, float octave, float semi
   osc->mod_depth_param = PARAM_TO_LINEAR(mod_depth,OSC_MOD_DEPTH_MIN, OSC_MOD_DEPTH_MAX);
   osc->mod_source_param = PARAM_TO_INT(mod_source, MOD_LFO_TRIANGLE, MOD_MAX_SOURCE-1);
   osc->pw_param = pw;
+  osc->pwm_source_param = PARAM_TO_INT(pwm_source, MOD_LFO_TRIANGLE, MOD_MAX_SOURCE-1);
+  osc->pwm_depth_param = pwm_depth;
   osc->level_param = level * 0.5f;  /* div by 2 as we have 2 oscillators*/
 }
 
+/*
+ * Oscillator kernels.  Each waveform is generated twice from the same macro, once writing the
+ * voice buffer (the first source in the voice) and once mixing into it, so there is no test of
+ * reset_buf per sample.  The BLEP waveforms split the block at the samples either side of each
+ * edge: the long stretches between edges are a plain ramp (or, for the pulse, a constant) and
+ * only the few samples near an edge run the polyBLEP correction.
+ */
+#define OSC_WRITE(ptr, sample) (*(ptr)++ = (sample))
+#define OSC_MIX(ptr, sample) (*(ptr)++ += (sample))
+
+/* Saw value with the polyBLEP correction either side of the falling edge at phase 0 */
+static inline float saw_blep(float phase, float inc)
+{
+  float saw = UNI_TO_BI(phase);
+
+  if (phase > 1.0f - inc)
+  {
+    float t = (phase - 1.0f) / inc;
+    saw += (t * t + 2.0f * t + 1.0f) * -1.0f;
+  }
+  else if (phase < inc)
+  {
+    /* Or the RH side */
+    float t = phase / inc;
+    saw += (2.0f * t - t * t - 1.0f) * -1.0f;
+  }
+
+  return saw;
+}
+
+/* Samples before the phase comes within one increment of the edge at phase 0, the BLEP needs none */
+static inline size_t samples_to_edge(float phase, float inc, float inv_inc)
+{
+  float clear = 1.0f - inc - phase;
+  return (phase < inc || clear < 0.0f) ? 0 : (size_t)(clear * inv_inc) + 1;
+}
+
+/* As samples_to_edge for an edge that may move either way, by up to speed per sample */
+static inline size_t samples_to_moving_edge(float phase, float inc, float inv_speed)
+{
+  float clear = fminf(phase - inc, 1.0f - inc - phase);
+  return (clear < 0.0f) ? 0 : (size_t)(clear * inv_speed) + 1;
+}
+
+/* Integrated polyBLEP, the residual for a unit change of slope per sample at phase 0 */
+static inline float blamp(float phase, float inc)
+{
+  if (phase < inc)
+  {
+    float t = 1.0f - phase / inc;
+    return t * t * t * (1.0f / 6.0f);
+  }
+  else if (phase > 1.0f - inc)
+  {
+    float t = 1.0f + (phase - 1.0f) / inc;
+    return t * t * t * (1.0f / 6.0f);
+  }
+
+  return 0.0f;
+}
+
+/* End of the straight run, limited to the block */
+static inline float *run_end(float *ptr, float *end, size_t run)
+{
+  return (run < (size_t)(end - ptr)) ? ptr + run : end;
+}
+
 /**
  * ugen_saw
  * \brief Generates bandlimited sawtooth waveform using polynomial BLEP method
  * \note Implements a polynomal BLEP (Band-Limited Step) oscillator to reduce aliasing.
  *       The algorithm applies correction terms at discontinuities to create
  *       a high-quality digital sawtooth suitable for subtractive synthesis.
- * \param osc Pointer to the oscillator instance
- * \param samples Output samples to write or mix samples into
- * \param block_size Number of samples to generate
+ *       The correction is only evaluated on the two samples either side of the edge.
  */
-static void ugen_saw(struct osc *osc, float *samples, size_t block_size)
-{
-  float *restrict ptr = samples;
-  float *restrict end = samples + block_size;
-
-  float inc = osc->inc;
-  float level = osc->level_param;
-  float phase = osc->phase;
-  bool reset_buf = osc->reset_buf;  
+#define OSC_KERNEL_SAW(name, STORE)                                     \
+  static void name(struct osc *osc, float *samples, size_t block_size) \
+  {                                                                    \
+    float *restrict ptr = samples;                                     \
+    float *restrict end = samples + block_size;                        \
+                                                                       \
+    float inc = osc->inc;                                              \
+    float inv_inc = 1.0f / inc;                                        \
+    float gain = osc->level_param * SAW_GAIN_SCALER;                   \
+    float phase = osc->phase;                                          \
+                                                                       \
+    while (ptr < end)                                                  \
+    {                                                                  \
+      float *restrict ramp = run_end(ptr, end, samples_to_edge(phase, inc, inv_inc)); \
+                                                                       \
+      _Pragma("GCC unroll 4")                                          \
+      while (ptr < ramp)                                               \
+      {                                                                \
+        STORE(ptr, soft_saturation(UNI_TO_BI(phase)) * gain);          \
+        phase += inc;                                                  \
+      }                                                                \
+                                                                       \
+      if (ptr < end)                                                   \
+      {                                                                \
+        STORE(ptr, soft_saturation(saw_blep(phase, inc)) * gain);      \
+        phase += inc;                                                  \
+        phase -= (int)phase;                                           \
+      }                                                                \
+    }                                                                  \
+                                                                       \
+    osc->phase = phase;                                                \
+  }
 
-#pragma GCC unroll 4
-  while (ptr < end)
-  {
-    float saw = UNI_TO_BI(phase);
+/*
+ * Pulse as the difference of two BLEP saws offset by the pulse width.  Between the edges the
+ * two ramps cancel so the run is a constant fill.
+ */
+#define OSC_KERNEL_PULSE(name, STORE)                                                            \
+  static void name(struct osc *osc, float *samples, size_t block_size)                          \
+  {                                                                                             \
+    float *restrict ptr = samples;                                                              \
+    float *restrict end = samples + block_size;                                                 \
+                                                                                                \
+    float phase = osc->phase;                                                                   \
+    float inc = osc->inc;                                                                       \
+    float inv_inc = 1.0f / inc;                                                                 \
+    float pulse_width = osc->pw;                                                                \
+    float corr = pulse_correction(pulse_width);                                                 \
+    float dc_offset = 1.0f - 2.0f * pulse_width;                                                \
+    float gain = osc->level_param * corr * PULSE_GAIN_SCALER;                                   \
+                                                                                                \
+    while (ptr < end)                                                                           \
+    {                                                                                           \
+      phase -= (int)phase;                                                                      \
+      float phase2 = phase + pulse_width;                                                       \
+      phase2 -= (int)phase2;                                                                    \
+                                                                                                \
+      size_t run1 = samples_to_edge(phase, inc, inv_inc);                                       \
+      size_t run2 = samples_to_edge(phase2, inc, inv_inc);                                      \
+      float *restrict flat = run_end(ptr, end, run1 < run2 ? run1 : run2);                      \
+                                                                                                \
+      if (ptr < flat)                                                                           \
+      {                                                                                         \
+        float sample = soft_saturation(UNI_TO_BI(phase) - UNI_TO_BI(phase2) - dc_offset) * gain; \
+        phase += (float)(flat - ptr) * inc;                                                     \
+                                                                                                \
+        _Pragma("GCC unroll 4")                                                                 \
+        while (ptr < flat)                                                                      \
+        {                                                                                       \
+          STORE(ptr, sample);                                                                   \
+        }                                                                                       \
+      }                                                                                         \
+      else                                                                                      \
+      {                                                                                         \
+        float saw1 = saw_blep(phase, inc);                                                      \
+        float saw2 = saw_blep(phase2, inc);                                                     \
+        STORE(ptr, soft_saturation(saw1 - saw2 - dc_offset) * gain);                            \
+        phase += inc;                                                                           \
+      }                                                                                         \
+    }                                                                                           \
+                                                                                                \
+    osc->phase = phase - (int)phase;                                                            \
+  }
 
-    /* Falling edge polynomial BLEP */
-    if (phase > 1.0f - inc)
-    {
-      float t = (phase - 1.0f) / inc;
-      saw += (t * t + 2.0f * t + 1.0f) * -1.0f;
-    }
-    else if (phase < inc)
-    {
-      /* Or the RH side */
-      float t = phase / inc;
-      saw += (2.0f * t - t * t - 1.0f) * -1.0f;
-    }
+/*
+ * Triangle with a polyBLAMP on the samples either side of each corner, the slope changes by
+ * 8 (per cycle) at the peak (phase 0) and the trough (phase 0.5).  Between the corners it is
+ * a straight ramp.
+ */
+#define OSC_KERNEL_TRIANGLE(name, STORE)                                                     \
+  static void name(struct osc *osc, float *samples, size_t block_size)                      \
+  {                                                                                         \
+    float *restrict ptr = samples;                                                          \
+    float *restrict end = samples + block_size;                                             \
+                                                                                            \
+    float phase = osc->phase;                                                               \
+    float inc = osc->inc;                                                                   \
+    float inv_inc = 1.0f / inc;                                                             \
+    float slope = 8.0f * inc;                                                               \
+    float gain = osc->level_param * TRI_GAIN_SCALER;                                        \
+                                                                                            \
+    while (ptr < end)                                                                       \
+    {                                                                                       \
+      float phase2 = phase + 0.5f;                                                          \
+      phase2 -= (int)phase2;                                                                \
+                                                                                            \
+      size_t run1 = samples_to_edge(phase, inc, inv_inc);                                   \
+      size_t run2 = samples_to_edge(phase2, inc, inv_inc);                                  \
+      float *restrict ramp = run_end(ptr, end, run1 < run2 ? run1 : run2);                  \
+                                                                                            \
+      _Pragma("GCC unroll 4")                                                               \
+      while (ptr < ramp)                                                                    \
+      {                                                                                     \
+        STORE(ptr, soft_saturation(2.0f * fabsf(2.0f * phase - 1.0f) - 1.0f) * gain);       \
+        phase += inc;                                                                       \
+      }                                                                                     \
+                                                                                            \
+      if (ptr < end)                                                                        \
+      {                                                                                     \
+        phase2 = phase + 0.5f;                                                              \
+        phase2 -= (int)phase2;                                                              \
+        float tri = 2.0f * fabsf(2.0f * phase - 1.0f) - 1.0f;                               \
+        tri += slope * (blamp(phase2, inc) - blamp(phase, inc));                            \
+        STORE(ptr, soft_saturation(tri) * gain);                                            \
+        phase += inc;                                                                       \
+        phase -= (int)phase;                                                                \
+      }                                                                                     \
+    }                                                                                       \
+                                                                                            \
+    osc->phase = phase;                                                                     \
+  }
 
-    phase += inc;
+/*
+ * Pulse width modulated per sample.  The second edge moves with the width so the flat runs
+ * stop short of it whichever way it is moving, the level correction is ramped rather than
+ * divided per sample.
+ */
+#define OSC_KERNEL_PWM(name, STORE)                                                                 \
+  static void name(struct osc *osc, float *samples, size_t block_size)                             \
+  {                                                                                                \
+    float *restrict ptr = samples;                                                                 \
+    float *restrict end = samples + block_size;                                                    \
+                                                                                                   \
+    float phase = osc->phase;                                                                      \
+    float inc = osc->inc;                                                                          \
+    float inv_inc = 1.0f / inc;                                                                    \
+    float pulse_width = osc->pw;                                                                   \
+    float pw_step = osc->pw_step;                                                                  \
+    float inv_speed = 1.0f / (inc + fabsf(pw_step));                                               \
+    float corr = pulse_correction(pulse_width);                                                    \
+    float corr_step = (pulse_correction(pulse_width + pw_step * block_size) - corr) / block_size;  \
+    float gain = osc->level_param * PULSE_GAIN_SCALER;                                             \
+                                                                                                   \
+    while (ptr < end)                                                                              \
+    {                                                                                              \
+      phase -= (int)phase;                                                                         \
+      float phase2 = phase + pulse_width;                                                          \
+      phase2 -= (int)phase2;                                                                       \
+      float dc_offset = 1.0f - 2.0f * pulse_width;                                                 \
+                                                                                                   \
+      size_t run1 = samples_to_edge(phase, inc, inv_inc);                                          \
+      size_t run2 = samples_to_moving_edge(phase2, inc, inv_speed);                                \
+      float *restrict flat = run_end(ptr, end, run1 < run2 ? run1 : run2);                         \
+                                                                                                   \
+      if (ptr < flat)                                                                              \
+      {                                                                                            \
+        float level = soft_saturation(UNI_TO_BI(phase) - UNI_TO_BI(phase2) - dc_offset) * gain;    \
+        float run = (float)(flat - ptr);                                                           \
+        phase += run * inc;                                                                        \
+        pulse_width += run * pw_step;                                                              \
+                                                                                                   \
+        _Pragma("GCC unroll 4")                                                                    \
+        while (ptr < flat)                                                                         \
+        {                                                                                          \
+          STORE(ptr, level * corr);                                                                \
+          corr += corr_step;                                                                       \
+        }                                                                                          \
+      }                                                                                            \
+      else                                                                                         \
+      {                                                                                            \
+        float saw1 = saw_blep(phase, inc);                                                         \
+        float saw2 = saw_blep(phase2, inc);                                                        \
+        STORE(ptr, soft_saturation(saw1 - saw2 - dc_offset) * gain * corr);                        \
+        phase += inc;                                                                              \
+        pulse_width += pw_step;                                                                    \
+        corr += corr_step;                                                                         \
+      }                                                                                            \
+    }                                                                                              \
+                                                                                                   \
+    osc->phase = phase - (int)phase;                                                               \
+    osc->pw = pulse_width;                                                                         \
+  }
 
-    if (phase > 1.0f)
-      phase -= 1.0f;
+/**
+ * ugen_wavetable
+ * \brief Generates a waveform from the band-limited wavetables
+ * \note The mip level is chosen once per call from the phase increment so every harmonic
+ *       stays below Nyquist.  Each sample is linearly interpolated within the table and
+ *       crossfaded between the two frames either side of the table position, the per-sample
+ *       cost is fixed and there are no branches on the waveform.
+ */
+#define OSC_KERNEL_WAVETABLE(name, STORE)                                   \
+  static void name(struct osc *osc, float *samples, size_t block_size)     \
+  {                                                                        \
+    float *restrict ptr = samples;                                         \
+    float *restrict end = samples + block_size;                            \
+                                                                           \
+    float phase = osc->phase;                                              \
+    float inc = osc->inc;                                                  \
+    float level = osc->level_param * WAVETABLE_GAIN_SCALER;                \
+                                                                           \
+    const float *table_a, *table_b;                                        \
+    float fade;                                                            \
+    wavetable_select(inc, osc->pw, &table_a, &table_b, &fade);             \
+                                                                           \
+    _Pragma("GCC unroll 4")                                                \
+    while (ptr < end)                                                      \
+    {                                                                      \
+      float index = phase * WT_LENGTH;                                     \
+      int i = (int)index;                                                  \
+      float frac = index - i;                                              \
+                                                                           \
+      float a = table_a[i] + frac * (table_a[i + 1] - table_a[i]);         \
+      float b = table_b[i] + frac * (table_b[i + 1] - table_b[i]);         \
+                                                                           \
+      STORE(ptr, soft_saturation(a + fade * (b - a)) * level);             \
+                                                                           \
+      /* Wrap without a branch, the phase is never negative */             \
+      phase += inc;                                                        \
+      phase -= (int)phase;                                                 \
+    }                                                                      \
+                                                                           \
+    osc->phase = phase;                                                    \
+  }
 
-    float sample = soft_saturation(saw) * level * SAW_GAIN_SCALER;
-    
-    if (reset_buf)
-      *ptr++ = sample;
-    else
-      *ptr++ += sample;
+/*
+ * Supersaw, 7 saws sharing one loop.  The mixed naive saws are a single ramp (the slope is the
+ * sum of the weighted increments) that only steps when one of the phases wraps, so the block
+ * is split at the samples either side of every phase's edge as for the saw and only those
+ * samples evaluate each phase with its BLEP.  A one pole high-pass at the fundamental removes
+ * the low frequency beating.  The width control sets the detune and the mix of the side saws,
+ * there is no soft saturation as the sum can exceed its range.
+ */
+#define OSC_KERNEL_SUPERSAW(name, STORE)                                                                   \
+  static void name(struct osc *osc, float *samples, size_t block_size)                                    \
+  {                                                                                                       \
+    float *restrict ptr = samples;                                                                        \
+    float *restrict end = samples + block_size;                                                           \
+                                                                                                          \
+    float detune = supersaw_detune(osc->pw);                                                              \
+    float centre = -0.55366f * osc->pw + 0.99785f;                                                        \
+    float side = (-0.73764f * osc->pw + 1.2841f) * osc->pw + 0.044372f;                                   \
+    float gain = osc->level_param * SUPERSAW_GAIN_SCALER /                                                \
+                 sqrtf(centre * centre + (OSC_SUPERSAW_PHASES - 1) * side * side);                        \
+    float hp = 1.0f / (1.0f + DAE_TWO_PI * osc->inc);                                                     \
+    float hp_x1 = osc->hp_x1;                                                                             \
+    float hp_y1 = osc->hp_y1;                                                                             \
+                                                                                                          \
+    float phase[OSC_SUPERSAW_PHASES];                                                                     \
+    float inc[OSC_SUPERSAW_PHASES];                                                                       \
+    float inv_inc[OSC_SUPERSAW_PHASES];                                                                   \
+    float mix[OSC_SUPERSAW_PHASES];                                                                       \
+    float slope = 0.0f;                                                                                   \
+                                                                                                          \
+    for (int j = 0; j < OSC_SUPERSAW_PHASES; j++)                                                         \
+    {                                                                                                     \
+      phase[j] = (j == 0) ? osc->phase : osc->super_phase[j - 1];                                         \
+      inc[j] = osc->inc * (1.0f + detune * supersaw_offset[j]);                                           \
+      inv_inc[j] = 1.0f / inc[j];                                                                         \
+      mix[j] = (j == 0) ? centre : side;                                                                  \
+      slope += 2.0f * mix[j] * inc[j];                                                                    \
+    }                                                                                                     \
+                                                                                                          \
+    while (ptr < end)                                                                                     \
+    {                                                                                                     \
+      size_t run = block_size;                                                                            \
+      float x = 0.0f;                                                                                     \
+                                                                                                          \
+      _Pragma("GCC unroll 7")                                                                             \
+      for (int j = 0; j < OSC_SUPERSAW_PHASES; j++)                                                       \
+      {                                                                                                   \
+        size_t clear = samples_to_edge(phase[j], inc[j], inv_inc[j]);                                     \
+        run = (clear < run) ? clear : run;                                                                \
+        x += mix[j] * UNI_TO_BI(phase[j]);                                                                \
+      }                                                                                                   \
+                                                                                                          \
+      float *restrict ramp = run_end(ptr, end, run);                                                      \
+                                                                                                          \
+      if (ptr < ramp)                                                                                     \
+      {                                                                                                   \
+        float count = (float)(ramp - ptr);                                                                \
+                                                                                                          \
+        _Pragma("GCC unroll 7")                                                                           \
+        for (int j = 0; j < OSC_SUPERSAW_PHASES; j++)                                                     \
+        {                                                                                                 \
+          phase[j] += count * inc[j];                                                                     \
+        }                                                                                                 \
+                                                                                                          \
+        _Pragma("GCC unroll 4")                                                                           \
+        while (ptr < ramp)                                                                                \
+        {                                                                                                 \
+          hp_y1 = hp * (hp_y1 + x - hp_x1);                                                               \
+          hp_x1 = x;                                                                                      \
+          STORE(ptr, hp_y1 * gain);                                                                       \
+          x += slope;                                                                                     \
+        }                                                                                                 \
+      }                                                                                                   \
+      else                                                                                                \
+      {                                                                                                   \
+        x = 0.0f;                                                                                         \
+                                                                                                          \
+        _Pragma("GCC unroll 7")                                                                           \
+        for (int j = 0; j < OSC_SUPERSAW_PHASES; j++)                                                     \
+        {                                                                                                 \
+          x += mix[j] * saw_blep(phase[j], inc[j]);                                                       \
+          phase[j] += inc[j];                                                                             \
+          phase[j] -= (int)phase[j];                                                                      \
+        }                                                                                                 \
+                                                                                                          \
+        hp_y1 = hp * (hp_y1 + x - hp_x1);                                                                 \
+        hp_x1 = x;                                                                                        \
+        STORE(ptr, hp_y1 * gain);                                                                         \
+      }                                                                                                   \
+    }                                                                                                     \
+                                                                                                          \
+    osc->phase = phase[0];                                                                                \
+    for (int j = 1; j < OSC_SUPERSAW_PHASES; j++)                                                         \
+    {                                                                                                     \
+      osc->super_phase[j - 1] = phase[j];                                                                 \
+    }                                                                                                     \
+                                                                                                          \
+    osc->hp_x1 = hp_x1;                                                                                   \
+    osc->hp_y1 = hp_y1;                                                                                   \
   }
 
-  osc->phase = phase;
-}
+/**
+ * ugen_fm
+ * \brief Generates the slave oscillator under linear through-zero FM from the master
+ * \note The master output in the shared buffer scales the phase increment per sample, the
+ *       increment may go negative (through zero) so the phase wraps in both directions.
+ *       The waveform is read from the band-limited wavetables, the mip level allows for the
+ *       peak deviation.
+ */
+#define OSC_KERNEL_FM(name, STORE)                                                                          \
+  static void name(struct osc *osc, float *samples, size_t block_size)                                     \
+  {                                                                                                        \
+    float *restrict ptr = samples;                                                                         \
+    float *restrict end = samples + block_size;                                                            \
+    const float *restrict mod = osc->xmod + (samples - osc->samples);                                      \
+                                                                                                           \
+    float phase = osc->phase;                                                                              \
+    float inc = osc->inc;                                                                                  \
+    float deviation = inc * osc->fm_index;                                                                 \
+    float level = osc->level_param * WAVETABLE_GAIN_SCALER;                                                \
+                                                                                                           \
+    float position = (osc->wave_param == OSC_WAVETABLE) ? osc->pw : fm_position[osc->wave_param];          \
+                                                                                                           \
+    const float *table_a, *table_b;                                                                        \
+    float fade;                                                                                            \
+    wavetable_select(inc + deviation, position, &table_a, &table_b, &fade);                                \
+                                                                                                           \
+    _Pragma("GCC unroll 4")                                                                                \
+    while (ptr < end)                                                                                      \
+    {                                                                                                      \
+      float index = phase * WT_LENGTH;                                                                     \
+      int i = (int)index;                                                                                  \
+      float frac = index - i;                                                                              \
+                                                                                                           \
+      float a = table_a[i] + frac * (table_a[i + 1] - table_a[i]);                                         \
+      float b = table_b[i] + frac * (table_b[i + 1] - table_b[i]);                                         \
+                                                                                                           \
+      STORE(ptr, soft_saturation(a + fade * (b - a)) * level);                                             \
+                                                                                                           \
+      phase = wrap_phase(phase + inc + deviation * *mod++);                                                \
+    }                                                                                                      \
+                                                                                                           \
+    osc->phase = phase;                                                                                    \
+  }
 
+OSC_KERNEL_SAW(ugen_saw_write, OSC_WRITE)
+OSC_KERNEL_SAW(ugen_saw_mix, OSC_MIX)
+OSC_KERNEL_PULSE(ugen_pulse_write, OSC_WRITE)
+OSC_KERNEL_PULSE(ugen_pulse_mix, OSC_MIX)
+OSC_KERNEL_PWM(ugen_pwm_write, OSC_WRITE)
+OSC_KERNEL_PWM(ugen_pwm_mix, OSC_MIX)
+OSC_KERNEL_TRIANGLE(ugen_triangle_write, OSC_WRITE)
+OSC_KERNEL_TRIANGLE(ugen_triangle_mix, OSC_MIX)
+OSC_KERNEL_WAVETABLE(ugen_wavetable_write, OSC_WRITE)
+OSC_KERNEL_WAVETABLE(ugen_wavetable_mix, OSC_MIX)
+OSC_KERNEL_SUPERSAW(ugen_supersaw_write, OSC_WRITE)
+OSC_KERNEL_SUPERSAW(ugen_supersaw_mix, OSC_MIX)
+OSC_KERNEL_FM(ugen_fm_write, OSC_WRITE)
+OSC_KERNEL_FM(ugen_fm_mix, OSC_MIX)
 
-static void ugen_triangle(struct osc *osc, float *samples, size_t block_size)
+/*
+ * Writes the master's sync stream for a sub-block.  For each sample this is the fraction of
+ * a sample that has elapsed since the master wrapped, or -1 if it did not wrap.
+ */
+static void osc_sync_stream(struct osc *osc, float *sync, size_t count)
 {
-  float *restrict ptr = samples;
-  float *restrict end = samples + block_size;
-
-  float phase = osc->phase;
+  float phase = wrap_phase(osc->phase);
   float inc = osc->inc;
-  bool reset_buf = osc->reset_buf;
-  bool level = osc->level_param;
+  float inv_inc = 1.0f / inc;
 
-#pragma GCC unroll 4
-  while (ptr < end)
+  while (count--)
   {
-    float sample = soft_saturation(2.0f * fabsf(2.0f * phase - 1.0f) - 1.0f) * level * TRI_GAIN_SCALER;
+    *sync++ = (phase < inc) ? phase * inv_inc : -1.0f;
 
-    if (reset_buf)
-      *ptr++ = sample;
-    else
-      *ptr++ += sample;
-
-    if (phase > 1.0f)
-      phase -= 1.0f;
-
-    phase += inc;    
-  }  
-  osc->phase = phase;
+    phase += inc;
+    phase -= (int)phase;
+  }
 }
 
-static void ugen_pulse(struct osc *osc, float *samples, size_t block_size)
+/*
+ * Renders a slave oscillator hard synced to the master.  The sub-block is split at each
+ * master wrap and the phase restarts from where, within the sample, the master wrapped.
+ * The step in the output is smoothed with a polyBLEP on the samples either side of the
+ * reset, less any step the generator has already corrected for at its own phase zero edge.
+ */
+static void osc_render_synced(struct osc *osc, float *samples, const float *sync, size_t count, bool has_previous)
 {
-  float *restrict ptr = samples;
-  float *restrict end = samples + block_size;
+  void (*generator)(struct osc *osc, float *samples, size_t block_size) = osc_generator(osc);
+  float (*value)(struct osc *osc, float phase) = wave_value[osc->wave_param];
 
-  float phase = osc->phase;
-  float inc = osc->inc;
-  float pulse_width = osc->pw_param;
-  float corr = (pulse_width < 0.5f) ? 1.0f / (1.0f - pulse_width) : 1.0f / pulse_width;
-  float dc_offset = 1.0f - 2.0f * pulse_width;
-  bool reset_buf = osc->reset_buf;
-  bool level = osc->level_param;
+  size_t start = 0;
+  float pending = 0.0f;
 
-#pragma GCC unroll 4
-  while (ptr < end)
+  for (size_t n = 0; n < count; n++)
   {
-    if (phase >= 1.0f)
-      phase -= 1.0f;
+    float d = sync[n];
 
-    float phase_tmp = phase;
-    float saw1 = UNI_TO_BI(phase_tmp);
+    if (d < 0.0f)
+    {
+      continue;
+    }
 
-    if (phase_tmp > 1.0f - inc)
+    if (n > start)
     {
-      float t = (phase_tmp - 1.0f) / inc;
-      saw1 += (t * t + 2.0f * t + 1.0f) * -1.0f;
+      generator(osc, samples + start, n - start);
+      samples[start] += pending;
     }
-    else if (phase_tmp < inc)
+
+    float inc = osc->inc;
+    float reset = value(osc, 0.0f);
+    float step = reset - value(osc, osc->phase - d * inc);
+    float edge = reset - value(osc, 1.0f - 1e-6f);
+
+    if (n > 0 || has_previous)
     {
-      float t = phase_tmp / inc;
-      saw1 += (2.0f * t - t * t - 1.0f) * -1.0f;
+      samples[(int)n - 1] += 0.5f * step * d * d;
     }
 
-    phase_tmp += pulse_width;
+    pending = -0.5f * (step - edge) * (1.0f - d) * (1.0f - d);
+    osc->phase = d * inc;
+    start = n;
+  }
 
-    if (phase_tmp >= 1.0f)
-      phase_tmp -= 1.0f;
+  generator(osc, samples + start, count - start);
+  samples[start] += pending;
+}
 
-    float saw2 = UNI_TO_BI(phase_tmp);
+static float value_saw(struct osc *osc, float phase)
+{
+  return soft_saturation(UNI_TO_BI(wrap_phase(phase))) * osc->level_param * SAW_GAIN_SCALER;
+}
 
-    if (phase_tmp > 1.0f - inc)
-    {
-      float t = (phase_tmp - 1.0f) / inc;
-      saw2 += (t * t + 2.0f * t + 1.0f) * -1.0f;
-    }
-    else if (phase_tmp < inc)
-    {
-      float t = phase_tmp / inc;
-      saw2 += (2.0f * t - t * t - 1.0f) * -1.0f;
-    }
+static float value_triangle(struct osc *osc, float phase)
+{
+  phase = wrap_phase(phase);
+  return soft_saturation(2.0f * fabsf(2.0f * phase - 1.0f) - 1.0f) * osc->level_param * TRI_GAIN_SCALER;
+}
 
-    phase += inc;
+static float value_pulse(struct osc *osc, float phase)
+{
+  float pulse_width = osc->pw;
+  float corr = pulse_correction(pulse_width);
+  float dc_offset = 1.0f - 2.0f * pulse_width;
 
-    if (phase > 1.0f)
-      phase -= 1.0f;
+  phase = wrap_phase(phase);
+  float saw1 = UNI_TO_BI(phase);
+  float saw2 = UNI_TO_BI(wrap_phase(phase + pulse_width));
 
-    float sample = (soft_saturation(saw1 - saw2 - dc_offset) * level) * corr * PULSE_GAIN_SCALER;
+  return soft_saturation(saw1 - saw2 - dc_offset) * osc->level_param * corr * PULSE_GAIN_SCALER;
+}
 
-    if (reset_buf)
-      *ptr++ = sample;
-    else
-      *ptr++ += sample;
-  }
+static float value_wavetable(struct osc *osc, float phase)
+{
+  const float *table_a, *table_b;
+  float fade;
+  wavetable_select(osc->inc, osc->pw, &table_a, &table_b, &fade);
 
-  osc->phase = phase;
-}
\ No newline at end of file
+  float index = wrap_phase(phase) * WT_LENGTH;
+  int i = (int)index;
+  float frac = index - i;
+
+  float a = table_a[i] + frac * (table_a[i + 1] - table_a[i]);
+  float b = table_b[i] + frac * (table_b[i + 1] - table_b[i]);
+
+  return soft_saturation(a + fade * (b - a)) * osc->level_param * WAVETABLE_GAIN_SCALER;
+}
@@ -19,18 +19,24 @@
 #include <stddef.h>
 
 #include "params.h"
+#include "mod_matrix.h"
 #include "dsp_core.h"
 #include "dsp_math.h"
+#include "wavetable.h"
 
 
 #include "trace.h"
 
+/* Supersaw, a centre saw and detuned saws either side */
+#define OSC_SUPERSAW_PHASES (7)
 
 struct osc
 {
   /* Buffers */
   float *samples;  
   float *modulators;
+  const float *const *mod_samples; /* Per-sample modulation at the base rate, NULL where block rate */
+  const struct mod_matrix *matrix;
 
   /* Parameters */
   enum osc_wave wave_param;
@@ -40,24 +46,56 @@ struct osc
   float level_param;
   enum mod_source mod_source_param;
   float mod_depth_param;
-  float pw_param;
+  float pw_param;     /* Pulse width, or table position for the wavetable */
+  enum mod_source pwm_source_param;
+  float pwm_depth_param;
+  enum mod_target pitch_target;
   
   /* Private Data */
   float fsr;
+  float oversample; /* Render rate as a multiple of fsr */
+  uint8_t rate_shift; /* Render samples per base rate sample (log2) */
   float phase;
   float inc;
   float pitch; 
 
+  /* Portamento, pitch offset in semitones gliding towards zero */
+  float glide;
+  float glide_rate;
+
+  /* Pitch offset (semitones) reached at the end of the last block, the start of the next ramp */
+  float semitones;
+  bool semitones_valid;
+
+  /* Supersaw detuned phases (the centre is phase) and its high-pass state */
+  float super_phase[OSC_SUPERSAW_PHASES - 1];
+  float hp_x1, hp_y1;
+
+  /* Modulated pulse width, ramped per sample from the last block's value */
+  float pw;
+  float pw_step;
+
+  /* Cross modulation, OSC1 (the master) drives OSC2 through a shared per-sample buffer */
+  bool xmod_master;
+  enum xmod_mode xmod_mode;
+  float *xmod;
+  float fm_index;
+
   bool reset_buf;
 };
 
 /* API */
-void osc_init(struct osc *osc, float fsr, float *samples, float *modulators, bool reset_buf);
+void osc_init(struct osc *osc, float fsr, float *samples, float *modulators, const float *const *mod_samples, const struct mod_matrix *matrix, bool reset_buf);
 void osc_reset(struct osc *osc);
 void osc_render(struct osc *osc, size_t block_size);
 void osc_note_on(struct osc *osc, float pitch);
+void osc_note_change(struct osc *osc, float pitch);
 void osc_note_off(struct osc *osc);
-void osc_update_params(struct osc *osc, float waveform, float octave, float semi, float cents,float level, float mod_source, float mod_depth, float pw);
+void osc_glide(struct osc *osc, float semitones, float rate);
+void osc_xmod(struct osc *osc, enum xmod_mode mode, float *xmod, float depth);
+void osc_set_oversample(struct osc *osc, uint8_t factor);
+void osc_update_params(struct osc *osc, float waveform, float octave, float semi, float cents,float level, float mod_source, float mod_depth, float pw,
+                       float pwm_source, float pwm_depth);
 
 
 #endif /* OSC_H */
@@ -60,7 +60,63 @@ static const struct cc_mapping mappings[SYNTH_PARAM_MAX] =
         {60, LFO_RATE},
         {61, LFO_TRIGGER_MODE},
         {84, AMP_ENV_VEL_SENS},
-        {85, AMP_ENV_NOTE_TRACK}};
+        {85, AMP_ENV_NOTE_TRACK},
+
+        {86, VOICE_MODE},
+        {87, NOTE_PRIORITY},
+        {88, PORTAMENTO_MODE},
+        {MIDI_CC_LEGATO, LEGATO_MODE},
+        {MIDI_CC_PORTAMENTOTIME, PORTAMENTO_TIME},
+
+        {89, OSC_XMOD_MODE},
+        {90, OSC_XMOD_DEPTH},
+
+        {102, NOISE_TYPE},
+        {103, NOISE_LEVEL},
+
+        {104, OVERSAMPLE_MODE},
+
+        {105, PWM_SOURCE},
+        {106, PWM_DEPTH},
+
+        {107, FILTER_NOTE_TRACK},
+        {108, FILTER_VEL_TRACK},
+
+        {109, SEG_ENV_DELAY},
+        {110, SEG_ENV_ATTACK},
+        {111, SEG_ENV_HOLD},
+        {112, SEG_ENV_DECAY},
+        {113, SEG_ENV_SUSTAIN},
+        {114, SEG_ENV_RELEASE},
+        {115, SEG_ENV_LOOP},
+        {116, SEG_ENV_CURVE},
+        {117, SEG_ENV_SYNC},
+        {118, LFO_RANGE},
+
+        {16, MOD_MATRIX1_SOURCE},
+        {17, MOD_MATRIX1_DEST},
+        {18, MOD_MATRIX1_AMOUNT},
+        {19, MOD_MATRIX1_VIA},
+
+        {14, MOD_MATRIX2_SOURCE},
+        {15, MOD_MATRIX2_DEST},
+        {27, MOD_MATRIX2_AMOUNT},
+        {28, MOD_MATRIX2_VIA},
+
+        {75, MOD_MATRIX3_SOURCE},
+        {76, MOD_MATRIX3_DEST},
+        {77, MOD_MATRIX3_AMOUNT},
+        {78, MOD_MATRIX3_VIA},
+
+        {79, MOD_MATRIX4_SOURCE},
+        {80, MOD_MATRIX4_DEST},
+        {81, MOD_MATRIX4_AMOUNT},
+        {82, MOD_MATRIX4_VIA},
+
+        {MIDI_CC_PAN, PAN},
+        {119, PAN_KEY_TRACK},
+
+        {3, LFO_SYNC}};
 
 /* Populates the CC->param map array with the mappings defined in the const structure array above */
 static void populate_cc_array(uint8_t map_array[])
@@ -137,7 +193,56 @@ static const struct patch_parameter base_patch[SYNTH_PARAM_MAX] =
         {MOD_ENV_MODE, E2M(ENV_NORMAL, ENV_MODE_MAX-1)},
 
         {LFO_RATE,0},
-        {LFO_TRIGGER_MODE,E2M(LFO_NOTE, LFO_MODE_MAX-1)}};
+        {LFO_TRIGGER_MODE,E2M(LFO_NOTE, LFO_MODE_MAX-1)},
+
+        {VOICE_MODE, E2M(VOICE_POLY, VOICE_MODE_MAX-1)},
+        {NOTE_PRIORITY, E2M(NOTE_PRIORITY_LAST, NOTE_PRIORITY_MAX-1)},
+        {LEGATO_MODE, E2M(SWITCH_ON, SWITCH_MAX-1)},
+        {PORTAMENTO_TIME, 0},
+        {PORTAMENTO_MODE, E2M(GLIDE_CONSTANT_TIME, GLIDE_MODE_MAX-1)},
+
+        {OSC_XMOD_MODE, E2M(XMOD_OFF, XMOD_MODE_MAX-1)},
+        {OSC_XMOD_DEPTH, 0},
+
+        {NOISE_TYPE, E2M(NOISE_WHITE, NOISE_TYPE_MAX-1)},
+        {NOISE_LEVEL, 0},
+
+        {OVERSAMPLE_MODE, E2M(OVERSAMPLE_OFF, OVERSAMPLE_MODE_MAX-1)},
+
+        {PWM_SOURCE, E2M(MOD_LFO_TRIANGLE, MOD_MAX_SOURCE-1)},
+        {PWM_DEPTH, 0},
+
+        {FILTER_VEL_TRACK, E2M(SWITCH_OFF, SWITCH_MAX-1)},
+
+        {SEG_ENV_DELAY, 0},
+        {SEG_ENV_ATTACK, 40},
+        {SEG_ENV_HOLD, 0},
+        {SEG_ENV_DECAY, 50},
+        {SEG_ENV_SUSTAIN, 64},
+        {SEG_ENV_RELEASE, 50},
+        {SEG_ENV_LOOP, E2M(SEG_LOOP_OFF, SEG_LOOP_MODE_MAX-1)},
+        {SEG_ENV_CURVE, E2M(SEG_CURVE_EXP, SEG_CURVE_MAX-1)},
+        {SEG_ENV_SYNC, E2M(SWITCH_OFF, SWITCH_MAX-1)},
+        {LFO_RANGE, E2M(LFO_RANGE_LOW, LFO_RANGE_MAX-1)},
+        {MOD_MATRIX1_SOURCE, E2M(MOD_LFO_TRIANGLE, MOD_MAX_SOURCE-1)},
+        {MOD_MATRIX1_DEST, E2M(MOD_DEST_OFF, MOD_DEST_MAX-1)},
+        {MOD_MATRIX1_AMOUNT, 64},
+        {MOD_MATRIX1_VIA, 0},
+        {MOD_MATRIX2_SOURCE, E2M(MOD_LFO_TRIANGLE, MOD_MAX_SOURCE-1)},
+        {MOD_MATRIX2_DEST, E2M(MOD_DEST_OFF, MOD_DEST_MAX-1)},
+        {MOD_MATRIX2_AMOUNT, 64},
+        {MOD_MATRIX2_VIA, 0},
+        {MOD_MATRIX3_SOURCE, E2M(MOD_LFO_TRIANGLE, MOD_MAX_SOURCE-1)},
+        {MOD_MATRIX3_DEST, E2M(MOD_DEST_OFF, MOD_DEST_MAX-1)},
+        {MOD_MATRIX3_AMOUNT, 64},
+        {MOD_MATRIX3_VIA, 0},
+        {MOD_MATRIX4_SOURCE, E2M(MOD_LFO_TRIANGLE, MOD_MAX_SOURCE-1)},
+        {MOD_MATRIX4_DEST, E2M(MOD_DEST_OFF, MOD_DEST_MAX-1)},
+        {MOD_MATRIX4_AMOUNT, 64},
+        {MOD_MATRIX4_VIA, 0},
+        {PAN, 64},
+        {PAN_KEY_TRACK, 64},
+        {LFO_SYNC, E2M(SWITCH_OFF, SWITCH_MAX-1)}};
         
 /* Patch bank patches, these are differential - stored as variations from the base patch
    The parameters within do not have to be in any particular order as they are applied by ID */
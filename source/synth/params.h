@@ -27,6 +27,9 @@
 #define SAW_GAIN_SCALER (2.5f)      /* Saw perceived loudness compensation */  
 #define TRI_GAIN_SCALER (1.0f)      /* Triangle perceived loudness compensation*/
 #define PULSE_GAIN_SCALER (0.5f)    /* Pulse perceived loudness compensation */
+#define WAVETABLE_GAIN_SCALER (2.0f) /* Wavetable perceived loudness compensation (tables are normalised) */
+#define NOISE_GAIN_SCALER (0.5f)    /* Noise source shares the oscillator headroom */
+#define SUPERSAW_GAIN_SCALER (2.0f) /* Supersaw perceived loudness compensation (mix is normalised) */
 
 
 enum param_id
@@ -79,6 +82,63 @@ enum param_id
   LFO_RATE,
   LFO_TRIGGER_MODE,
 
+  VOICE_MODE,
+  NOTE_PRIORITY,
+  LEGATO_MODE,
+  PORTAMENTO_TIME,
+  PORTAMENTO_MODE,
+
+  OSC_XMOD_MODE,
+  OSC_XMOD_DEPTH,
+
+  NOISE_TYPE,
+  NOISE_LEVEL,
+
+  OVERSAMPLE_MODE,
+
+  PWM_SOURCE,
+  PWM_DEPTH,
+
+  FILTER_VEL_TRACK,
+
+  SEG_ENV_DELAY,
+  SEG_ENV_ATTACK,
+  SEG_ENV_HOLD,
+  SEG_ENV_DECAY,
+  SEG_ENV_SUSTAIN,
+  SEG_ENV_RELEASE,
+  SEG_ENV_LOOP,
+  SEG_ENV_CURVE,
+  SEG_ENV_SYNC,
+
+  LFO_RANGE,
+
+  /* Modulation matrix, each slot's parameters are contiguous and in this order */
+  MOD_MATRIX1_SOURCE,
+  MOD_MATRIX1_DEST,
+  MOD_MATRIX1_AMOUNT,
+  MOD_MATRIX1_VIA,
+
+  MOD_MATRIX2_SOURCE,
+  MOD_MATRIX2_DEST,
+  MOD_MATRIX2_AMOUNT,
+  MOD_MATRIX2_VIA,
+
+  MOD_MATRIX3_SOURCE,
+  MOD_MATRIX3_DEST,
+  MOD_MATRIX3_AMOUNT,
+  MOD_MATRIX3_VIA,
+
+  MOD_MATRIX4_SOURCE,
+  MOD_MATRIX4_DEST,
+  MOD_MATRIX4_AMOUNT,
+  MOD_MATRIX4_VIA,
+
+  PAN,
+  PAN_KEY_TRACK,
+
+  LFO_SYNC,
+
   SYNTH_PARAM_MAX
 };
 
@@ -91,6 +151,8 @@ enum mod_source
   MOD_LFO_SQUARE,
   MOD_LFO_SANDH,
   MOD_ENV_LEVEL,
+  MOD_NOISE,
+  MOD_SEG_ENV,
   MOD_MAX_SOURCE
 };
 
@@ -106,6 +168,8 @@ enum osc_wave
   OSC_TRIANGLE,
   OSC_SAW,
   OSC_PULSE,
+  OSC_WAVETABLE,
+  OSC_SUPERSAW,
   OSC_WAVE_MAX
 };
 
@@ -118,6 +182,23 @@ enum env_mode
   ENV_MODE_MAX
 };
 
+/* Segment envelope stage curve */
+enum seg_curve
+{
+  SEG_CURVE_LINEAR,
+  SEG_CURVE_EXP,
+  SEG_CURVE_MAX
+};
+
+/* Segment envelope stages repeated while the note is held */
+enum seg_loop_mode
+{
+  SEG_LOOP_OFF,
+  SEG_LOOP_AHD,
+  SEG_LOOP_DAHD,
+  SEG_LOOP_MODE_MAX
+};
+
 enum lfo_trigger_mode
 {
   LFO_NOTE,
@@ -125,6 +206,74 @@ enum lfo_trigger_mode
   LFO_MODE_MAX
 };
 
+/* Modulation matrix destinations */
+enum mod_dest
+{
+  MOD_DEST_OFF,
+  MOD_DEST_PITCH,      /* Both oscillators */
+  MOD_DEST_OSC2_PITCH,
+  MOD_DEST_PW,
+  MOD_DEST_CUTOFF,
+  MOD_DEST_AMP,
+  MOD_DEST_PAN,
+  MOD_DEST_MAX
+};
+
+/* LFO rate range, the audio range is rendered per sample */
+enum lfo_range
+{
+  LFO_RANGE_LOW,
+  LFO_RANGE_AUDIO,
+  LFO_RANGE_MAX
+};
+
+enum voice_mode
+{
+  VOICE_POLY,
+  VOICE_MONO,
+  VOICE_MODE_MAX
+};
+
+enum note_priority
+{
+  NOTE_PRIORITY_LAST,
+  NOTE_PRIORITY_LOW,
+  NOTE_PRIORITY_HIGH,
+  NOTE_PRIORITY_MAX
+};
+
+enum glide_mode
+{
+  GLIDE_CONSTANT_TIME,
+  GLIDE_CONSTANT_RATE,
+  GLIDE_MODE_MAX
+};
+
+enum noise_type
+{
+  NOISE_WHITE,
+  NOISE_PINK,
+  NOISE_TYPE_MAX
+};
+
+/* Oscillator and filter render rate */
+enum oversample_mode
+{
+  OVERSAMPLE_OFF,
+  OVERSAMPLE_2X,
+  OVERSAMPLE_MODE_MAX
+};
+
+/* OSC1 acting on OSC2 */
+enum xmod_mode
+{
+  XMOD_OFF,
+  XMOD_SYNC,
+  XMOD_RING,
+  XMOD_FM,
+  XMOD_MODE_MAX
+};
+
 enum filter_type
 {
   FILTER_LPF2,
@@ -133,6 +282,10 @@ enum filter_type
   FILTER_LPF4,
   FILTER_BPF4,
   FILTER_HPF4,
+  FILTER_SVF_LP,
+  FILTER_SVF_BP,
+  FILTER_SVF_HP,
+  FILTER_SVF_NOTCH,
   FILTER_TYPE_MAX
 };
 
@@ -0,0 +1,443 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#include "seg_env.h"
+#include "env_gen.h"
+
+/* Ranges to convert normalised parameters back to useful values */
+#define SEG_ENV_MS_MAX (10000.0f)
+#define SEG_ENV_POWER_EXP (2.0f)
+
+/* Tempo until one is set */
+#define SEG_ENV_DEFAULT_BPM (120.0f)
+
+/* Exponential stages fall to this fraction of their distance, exp(-4.95), before snapping */
+#define SEG_ENV_EXP_LOG (4.95f)
+
+/* Held indefinitely, longer than any note at a block rate */
+#define SEG_ENV_FOREVER (INT32_MAX)
+
+/* Stage lengths in beats when tempo synced, from none to 4 bars */
+static const float seg_env_beats[] =
+    {0.0f, 0.25f, 0.375f, 0.5f, 0.75f, 1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f, 12.0f, 16.0f};
+
+#define SEG_ENV_DIVISIONS (sizeof(seg_env_beats) / sizeof(seg_env_beats[0]))
+
+/* Stays at the current level until something changes the stage */
+static void seg_env_hold(struct seg_env *env)
+{
+  env->mul = 1.0f;
+  env->add = 0.0f;
+  env->blocks_left = SEG_ENV_FOREVER;
+}
+
+/**
+ * seg_env_begin
+ * \brief Works out the per block step for the current stage, from the current level
+ * \note A linear stage adds a constant, an exponential one closes a fixed fraction of the
+ *       distance to its level each block.  Both are the same multiply-add when rendering so
+ *       the curve costs nothing per block.  This only runs when a stage starts.
+ * \param env the envelope instance
+ * \return false if the stage has no length and is already complete
+ */
+static bool seg_env_begin(struct seg_env *env)
+{
+  const struct seg_stage *stage = &env->stages[env->stage];
+
+  float blocks = stage->time * (env->tempo_sync ? env->blocks_per_beat : env->blocks_per_ms);
+  env->blocks_left = (int32_t)(blocks + 0.5f);
+
+  if (env->blocks_left <= 0)
+  {
+    return false;
+  }
+
+  if (stage->curve == SEG_CURVE_LINEAR)
+  {
+    env->mul = 1.0f;
+    env->add = (stage->level - env->level) / env->blocks_left;
+  }
+  else
+  {
+    env->mul = env_gen_coeff(env->blocks_left * (1.0f / SEG_ENV_EXP_LOG));
+    env->add = stage->level * (1.0f - env->mul);
+  }
+
+  return true;
+}
+
+/**
+ * seg_env_advance
+ * \brief Completes the current stage and moves to the next
+ * \note While the note is held the loop end returns to the loop start and the sustain stage
+ *       holds its level.  Stages with no length are passed straight through, a loop made
+ *       only of those holds rather than spinning.
+ * \param env the envelope instance
+ */
+static void seg_env_advance(struct seg_env *env)
+{
+  if (env->stage == SEG_ENV_NONE)
+  {
+    seg_env_hold(env);
+    return;
+  }
+
+  for (int i = 0; i <= SEG_ENV_MAX_STAGES; i++)
+  {
+    int8_t stage = env->stage;
+    env->level = env->stages[stage].level;
+
+    if (env->gate && stage == env->loop_end && env->loop_start != SEG_ENV_NONE)
+    {
+      stage = env->loop_start;
+    }
+    else if (env->gate && stage == env->sustain_stage)
+    {
+      /* Follows the sustain level, which can change while held */
+      env->holding = true;
+      env->mul = 0.0f;
+      env->add = env->level;
+      env->blocks_left = SEG_ENV_FOREVER;
+      return;
+    }
+    else
+    {
+      stage++;
+    }
+
+    if (stage >= env->stage_count)
+    {
+      env->stage = SEG_ENV_NONE;
+      seg_env_hold(env);
+      return;
+    }
+
+    env->stage = stage;
+
+    if (seg_env_begin(env))
+    {
+      return;
+    }
+  }
+
+  seg_env_hold(env);
+}
+
+void seg_env_init(struct seg_env *env, float fsr, size_t block_size, float *env_level)
+{
+  RTT_ASSERT(env != NULL);
+  RTT_ASSERT(env_level != NULL);
+
+  env_gen_table_init();
+
+  env->env_level = env_level;
+  env->fsr = fsr;
+  env->block_size = block_size;
+  env->blocks_per_ms = fsr / (1000.0f * block_size);
+  env->stage_count = 0;
+  env->sustain_stage = SEG_ENV_NONE;
+  env->loop_start = SEG_ENV_NONE;
+  env->loop_end = SEG_ENV_NONE;
+  env->tempo_sync = false;
+  env->user_defined = false;
+  env->dahdsr = (struct seg_dahdsr){0};
+
+  seg_env_set_tempo(env, SEG_ENV_DEFAULT_BPM);
+  seg_env_reset(env);
+}
+
+void seg_env_reset(struct seg_env *env)
+{
+  RTT_ASSERT(env != NULL);
+
+  env->stage = SEG_ENV_NONE;
+  env->gate = false;
+  env->holding = false;
+  env->level = 0.0f;
+  seg_env_hold(env);
+}
+
+/**
+ * seg_env_render
+ * \brief Advances the envelope by one block and writes its level to the modulators
+ * \note One multiply-add and a count per block, the same work for any stage or curve.
+ * \param env the envelope instance
+ */
+void seg_env_render(struct seg_env *env)
+{
+  RTT_ASSERT(env != NULL);
+
+  env->level = env->level * env->mul + env->add;
+
+  if (--env->blocks_left <= 0)
+  {
+    seg_env_advance(env);
+  }
+
+  *env->env_level = env->level;
+}
+
+/**
+ * seg_env_note_on
+ * \brief Starts the first stage from the current level, so a retrigger does not jump
+ * \param env the envelope instance
+ */
+void seg_env_note_on(struct seg_env *env)
+{
+  RTT_ASSERT(env != NULL);
+
+  env->gate = true;
+  env->holding = false;
+
+  if (env->stage_count == 0)
+  {
+    return;
+  }
+
+  env->stage = 0;
+
+  if (!seg_env_begin(env))
+  {
+    seg_env_advance(env);
+  }
+}
+
+/**
+ * seg_env_note_off
+ * \brief Moves to the release stages, those after the sustain stage and loop
+ * \param env the envelope instance
+ */
+void seg_env_note_off(struct seg_env *env)
+{
+  RTT_ASSERT(env != NULL);
+
+  env->gate = false;
+  env->holding = false;
+
+  int8_t release = (env->sustain_stage > env->loop_end ? env->sustain_stage : env->loop_end) + 1;
+
+  if (env->stage == SEG_ENV_NONE || env->stage >= release)
+  {
+    return;
+  }
+
+  if (release >= env->stage_count)
+  {
+    env->stage = SEG_ENV_NONE;
+    seg_env_hold(env);
+    return;
+  }
+
+  env->stage = release;
+
+  if (!seg_env_begin(env))
+  {
+    seg_env_advance(env);
+  }
+}
+
+/**
+ * seg_env_set_tempo
+ * \brief Sets the tempo for synced stages, which takes effect as each stage starts
+ * \param env the envelope instance
+ * \param bpm the tempo in beats per minute
+ */
+void seg_env_set_tempo(struct seg_env *env, float bpm)
+{
+  RTT_ASSERT(env != NULL);
+  RTT_ASSERT(bpm > 0.0f);
+
+  env->blocks_per_beat = env->blocks_per_ms * 60000.0f / bpm;
+}
+
+/* Stage length from a time parameter, in ms or as a beat division when synced */
+static float seg_env_time(struct seg_env *env, float time)
+{
+  if (env->tempo_sync)
+  {
+    return seg_env_beats[PARAM_TO_INT(time, 0, (int)SEG_ENV_DIVISIONS - 1)];
+  }
+
+  return PARAM_TO_POWER(time, 0.0f, SEG_ENV_MS_MAX, SEG_ENV_POWER_EXP);
+}
+
+/*
+ * Keeps a playing envelope consistent with a changed definition.  A held sustain follows the
+ * new level and a stage that no longer exists finishes the envelope.
+ */
+static void seg_env_redefined(struct seg_env *env)
+{
+  if (env->stage >= env->stage_count)
+  {
+    env->stage = SEG_ENV_NONE;
+    env->holding = false;
+    seg_env_hold(env);
+  }
+  else if (env->holding)
+  {
+    env->add = env->stages[env->stage].level;
+  }
+}
+
+/*
+ * Builds the DAHDSR preset from the patch parameters.  The delay stage falls to zero, so
+ * looping from it gives a gap between cycles.  Delay and hold are always linear, the curve
+ * applies to the attack, decay and release.
+ */
+static void seg_env_build_dahdsr(struct seg_env *env)
+{
+  const struct seg_dahdsr *p = &env->dahdsr;
+  enum seg_curve curve_mode = PARAM_TO_INT(p->curve, 0, SEG_CURVE_MAX-1);
+
+  env->stages[0] = (struct seg_stage){0.0f, seg_env_time(env, p->delay), SEG_CURVE_LINEAR};
+  env->stages[1] = (struct seg_stage){1.0f, seg_env_time(env, p->attack), curve_mode};
+  env->stages[2] = (struct seg_stage){1.0f, seg_env_time(env, p->hold), SEG_CURVE_LINEAR};
+  env->stages[3] = (struct seg_stage){p->sustain, seg_env_time(env, p->decay), curve_mode};
+  env->stages[4] = (struct seg_stage){0.0f, seg_env_time(env, p->release), curve_mode};
+  env->stage_count = 5;
+  env->sustain_stage = 3;
+
+  switch (PARAM_TO_INT(p->loop, 0, SEG_LOOP_MODE_MAX-1))
+  {
+  case SEG_LOOP_AHD:
+    env->loop_start = 1;
+    env->loop_end = 3;
+    break;
+  case SEG_LOOP_DAHD:
+    env->loop_start = 0;
+    env->loop_end = 3;
+    break;
+  default:
+    env->loop_start = SEG_ENV_NONE;
+    env->loop_end = SEG_ENV_NONE;
+    break;
+  }
+}
+
+/**
+ * seg_env_define
+ * \brief Starts a user defined envelope of up to SEG_ENV_MAX_STAGES stages
+ * \note The stages start flat at zero with no sustain or loop, set them with
+ *       seg_env_set_stage() and seg_env_set_loop().  Patch changes keep the definition
+ *       until seg_env_use_dahdsr() is called.
+ * \param env the envelope instance
+ * \param stage_count the number of stages
+ */
+void seg_env_define(struct seg_env *env, uint8_t stage_count)
+{
+  RTT_ASSERT(env != NULL);
+  RTT_ASSERT(stage_count <= SEG_ENV_MAX_STAGES);
+
+  env->user_defined = true;
+  env->stage_count = stage_count;
+  env->sustain_stage = SEG_ENV_NONE;
+  env->loop_start = SEG_ENV_NONE;
+  env->loop_end = SEG_ENV_NONE;
+
+  for (int i = 0; i < stage_count; i++)
+  {
+    env->stages[i] = (struct seg_stage){0.0f, 0.0f, SEG_CURVE_LINEAR};
+  }
+
+  seg_env_redefined(env);
+}
+
+/**
+ * seg_env_set_stage
+ * \brief Sets one stage of a user defined envelope, taking effect when the stage next starts
+ * \param env the envelope instance
+ * \param index the stage, less than the defined stage count
+ * \param level the level reached at the end of the stage
+ * \param time the length in ms, or in beats when the envelope is tempo synced
+ * \param curve the curve of the stage
+ */
+void seg_env_set_stage(struct seg_env *env, uint8_t index, float level, float time, enum seg_curve curve)
+{
+  RTT_ASSERT(env != NULL);
+  RTT_ASSERT(env->user_defined);
+  RTT_ASSERT(index < env->stage_count);
+  RTT_ASSERT(time >= 0.0f);
+  RTT_ASSERT(curve < SEG_CURVE_MAX);
+
+  env->stages[index] = (struct seg_stage){level, time, curve};
+  seg_env_redefined(env);
+}
+
+/**
+ * seg_env_set_loop
+ * \brief Sets the sustain stage and loop points of a user defined envelope
+ * \note Any of them can be SEG_ENV_NONE, a loop needs both points.
+ * \param env the envelope instance
+ * \param sustain_stage holds at the end of this stage while the note is held
+ * \param loop_start the first stage of the loop
+ * \param loop_end the last stage of the loop, which returns to loop_start while the note is held
+ */
+void seg_env_set_loop(struct seg_env *env, int8_t sustain_stage, int8_t loop_start, int8_t loop_end)
+{
+  RTT_ASSERT(env != NULL);
+  RTT_ASSERT(env->user_defined);
+  RTT_ASSERT(sustain_stage >= SEG_ENV_NONE && sustain_stage < env->stage_count);
+  RTT_ASSERT((loop_start == SEG_ENV_NONE) == (loop_end == SEG_ENV_NONE));
+  RTT_ASSERT(loop_start <= loop_end && loop_end < env->stage_count);
+
+  env->sustain_stage = sustain_stage;
+  env->loop_start = loop_start;
+  env->loop_end = loop_end;
+}
+
+/**
+ * seg_env_use_dahdsr
+ * \brief Drops a user definition and goes back to the DAHDSR preset from the patch
+ * \param env the envelope instance
+ */
+void seg_env_use_dahdsr(struct seg_env *env)
+{
+  RTT_ASSERT(env != NULL);
+
+  env->user_defined = false;
+  seg_env_build_dahdsr(env);
+  seg_env_redefined(env);
+}
+
+/**
+ * seg_env_update_params
+ * \brief Takes the patch parameters, which rebuild the DAHDSR preset unless the stages are user defined
+ * \note Sync applies to either, a user definition's times become beats.
+ * \param env the envelope instance
+ * \param delay Delay time (0.0-1.0)
+ * \param attack Attack time (0.0-1.0)
+ * \param hold Hold time at full level (0.0-1.0)
+ * \param decay Decay time (0.0-1.0)
+ * \param sustain Sustain level (0.0-1.0)
+ * \param release Release time (0.0-1.0)
+ * \param loop Loop mode while the note is held (enum seg_loop_mode)
+ * \param curve Curve of the attack, decay and release (enum seg_curve)
+ * \param sync Stage times as tempo divisions (0.0=off, 1.0=on)
+ */
+void seg_env_update_params(struct seg_env *env, float delay, float attack, float hold, float decay,
+                           float sustain, float release, float loop, float curve, float sync)
+{
+  RTT_ASSERT(env != NULL);
+
+  env->tempo_sync = PARAM_TO_INT(sync, SWITCH_OFF, SWITCH_MAX-1);
+  env->dahdsr = (struct seg_dahdsr){delay, attack, hold, decay, sustain, release, loop, curve};
+
+  if (env->user_defined)
+  {
+    return;
+  }
+
+  seg_env_build_dahdsr(env);
+  seg_env_redefined(env);
+}
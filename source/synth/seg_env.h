@@ -0,0 +1,97 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#ifndef __SEG_ENV_H__
+#define __SEG_ENV_H__
+
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+#include "params.h"
+#include "dsp_core.h"
+#include "dsp_math.h"
+
+/* Maximum stages in a segment envelope definition */
+#define SEG_ENV_MAX_STAGES (8)
+
+/* No stage, for the sustain and loop points or when the envelope has finished */
+#define SEG_ENV_NONE (-1)
+
+struct seg_stage
+{
+  float level;         /* Level reached at the end of the stage */
+  float time;          /* Length in ms, or in beats when tempo synced */
+  enum seg_curve curve;
+};
+
+/* The patch parameters for the DAHDSR preset, kept so it can be rebuilt */
+struct seg_dahdsr
+{
+  float delay;
+  float attack;
+  float hold;
+  float decay;
+  float sustain;
+  float release;
+  float loop;
+  float curve;
+};
+
+struct seg_env
+{
+  /* Output value */
+  float *env_level;
+
+  /* Definition, the stages run in order from the level the envelope is at */
+  struct seg_stage stages[SEG_ENV_MAX_STAGES];
+  uint8_t stage_count;
+  int8_t sustain_stage; /* Holds at the end of this stage while the note is held */
+  int8_t loop_start;    /* While the note is held the end of loop_end returns to loop_start */
+  int8_t loop_end;
+  bool tempo_sync;
+  bool user_defined;    /* Stages set directly, the patch's DAHDSR does not replace them */
+  struct seg_dahdsr dahdsr;
+
+  /* Private data */
+  float fsr;
+  size_t block_size;
+  float blocks_per_ms;
+  float blocks_per_beat;
+
+  int8_t stage;
+  bool gate;
+  bool holding;
+  float level;
+  float mul;           /* Per block the level becomes level * mul + add */
+  float add;
+  int32_t blocks_left;
+};
+
+void seg_env_init(struct seg_env *env, float fsr, size_t block_size, float *env_level);
+void seg_env_reset(struct seg_env *env);
+void seg_env_render(struct seg_env *env);
+void seg_env_note_on(struct seg_env *env);
+void seg_env_note_off(struct seg_env *env);
+void seg_env_set_tempo(struct seg_env *env, float bpm);
+void seg_env_define(struct seg_env *env, uint8_t stage_count);
+void seg_env_set_stage(struct seg_env *env, uint8_t index, float level, float time, enum seg_curve curve);
+void seg_env_set_loop(struct seg_env *env, int8_t sustain_stage, int8_t loop_start, int8_t loop_end);
+void seg_env_use_dahdsr(struct seg_env *env);
+void seg_env_update_params(struct seg_env *env, float delay, float attack, float hold, float decay,
+  float sustain, float release, float loop, float curve, float sync);
+
+#endif /* __SEG_ENV_H__ */
@@ -13,27 +13,68 @@
 */
 #include "synth.h"
 
+/* Sample & hold seed for the shared LFO, distinct from the voice seeds */
+#define SYNTH_LFO_SEED (0x2545F491UL)
+
 static struct voice *find_oldest_voice_to_steal(struct synth *synth);
-static struct voice *find_oldest_voice_by_note(struct synth *synth, uint8_t note);
+static struct voice *find_quietest_released_voice(struct synth *synth);
+static struct voice *find_oldest_voice_by_note(struct synth *synth, uint8_t channel, uint8_t note);
 static void age_voices(struct synth *synth);
-static void synth_note_on(struct synth *synth, uint8_t note, uint8_t velocity);
-static void synth_note_off(struct synth *synth, uint8_t note);
+static void synth_note_on(struct synth *synth, uint8_t channel, uint8_t note, uint8_t velocity);
+static void synth_note_off(struct synth *synth, uint8_t channel, uint8_t note);
 static void synth_note_all_off(struct synth *synth);
-
-/* TODO sustain override */
-/* TODO portamento & bend */
+static void synth_mono_note_on(struct synth *synth, uint8_t note, uint8_t velocity);
+static void synth_mono_note_off(struct synth *synth, uint8_t note);
+static void synth_pedal_note_on(struct synth *synth, uint8_t channel, uint8_t note, uint8_t velocity);
+static void synth_pedal_note_off(struct synth *synth, uint8_t channel, uint8_t note);
+static void synth_sustain_pedal(struct synth *synth, uint8_t channel, bool down);
+static void synth_sostenuto_pedal(struct synth *synth, uint8_t channel, bool down);
+static uint8_t count_sounding_voices(struct synth *synth);
+static uint8_t count_rendered_voices(struct synth *synth);
+static void synth_shed_voice(struct synth *synth);
+static void synth_set_tempo(struct synth *synth, float bpm);
+
+/* TODO bend */
 
 void synth_init(struct synth *synth, float sample_rate, size_t block_size, uint8_t *midi_channel)
 {
   RTT_ASSERT(synth);
 
-  /* Allocate the memory for the voice output buffers */
+  /* Allocate the memory for the voice output buffers, these hold a block at the base rate until
+     the voices are mixed */
   synth->voice_buffer_block = pvPortMalloc(MAX_VOICES * block_size * sizeof(float));
   memset(synth->voice_buffer_block, 0, MAX_VOICES * block_size * sizeof(float));
 
+  /* Voices render one at a time so they share the oversampled render buffer, each decimates it
+     into its own output buffer */
+  size_t oversample_buffer_size = block_size * VOICE_OVERSAMPLE_MAX;
+
+  synth->voice_oversample_buffer = pvPortMalloc(oversample_buffer_size * sizeof(float));
+  memset(synth->voice_oversample_buffer, 0, oversample_buffer_size * sizeof(float));
+
   /* Allocate the buffer for modulation values */
   synth->voice_modulators_block = pvPortMalloc(MAX_VOICES * sizeof(float) * MOD_MAX_SOURCE);
-  memset(synth->voice_modulators_block, 0, sizeof(float) * MOD_MAX_SOURCE);
+  memset(synth->voice_modulators_block, 0, MAX_VOICES * sizeof(float) * MOD_MAX_SOURCE);
+
+  /* Voices render one at a time so they share a single cross modulation buffer */
+  synth->voice_xmod_buffer = pvPortMalloc(oversample_buffer_size * sizeof(float));
+  memset(synth->voice_xmod_buffer, 0, oversample_buffer_size * sizeof(float));
+
+  /* Likewise the per-sample envelope levels, a block each for the amp and mod envelopes */
+  synth->voice_env_buffer = pvPortMalloc(2 * block_size * sizeof(float));
+  memset(synth->voice_env_buffer, 0, 2 * block_size * sizeof(float));
+
+  /* And the per-sample waveforms of a note triggered LFO in the audio range */
+  synth->voice_lfo_buffer = pvPortMalloc(LFO_WAVES * block_size * sizeof(float));
+  memset(synth->voice_lfo_buffer, 0, LFO_WAVES * block_size * sizeof(float));
+
+  /* The shared LFO writes only its own waveforms to these arrays, it has its own sample buffer
+     as the voices read it after rendering their own */
+  synth->lfo_buffer = pvPortMalloc(LFO_WAVES * block_size * sizeof(float));
+  memset(synth->lfo_buffer, 0, LFO_WAVES * block_size * sizeof(float));
+  memset(synth->lfo_modulators, 0, sizeof(synth->lfo_modulators));
+  memset(synth->lfo_mod_samples, 0, sizeof(synth->lfo_mod_samples));
+  lfo_init(&synth->lfo, sample_rate, synth->lfo_modulators, synth->lfo_mod_samples, synth->lfo_buffer, SYNTH_LFO_SEED);
 
   /* Each voice gets a portion of the available audio headroom */
   synth->poly_attenuation = 1.0f / sqrtf(MAX_VOICES);
@@ -41,6 +82,27 @@ void synth_init(struct synth *synth, float sample_rate, size_t block_size, uint8
   /* Listen on all MIDI channels */
   *midi_channel = MIDI_OMNI;
 
+  /* Polyphonic until the patch says otherwise, no previous note to glide from */
+  synth->voice_mode = VOICE_POLY;
+  synth->note_priority = NOTE_PRIORITY_LAST;
+  synth->legato = true;
+  synth->note_stack.count = 0;
+  synth->last_note_freq = 0.0f;
+
+  /* All pedals up */
+  memset(synth->pedals, 0, sizeof(synth->pedals));
+
+  /* Start with full polyphony, the governor reduces it once it has measured the patch */
+  governor_init(&synth->governor, sample_rate, block_size, MAX_VOICES);
+
+#ifdef SYNTH_BENCHMARK
+  /* Time the DSP kernels now the cycle counter is running, before any voice is playing */
+  bench_run(sample_rate, block_size);
+#endif
+
+  /* MIDI clock is time-stamped with the same clock the governor uses */
+  tempo_init(&synth->tempo, CPU_CLOCK_TICKS_PER_SECOND);
+
   /* Load parameters into the DAE parameter store */
   load_factory_patch(0, synth->cc_to_param_map);
 
@@ -50,7 +112,12 @@ void synth_init(struct synth *synth, float sample_rate, size_t block_size, uint8
     synth->voice[i].id = i;
     voice_init(&synth->voice[i], synth->params, 
                 synth->voice_buffer_block + (i * block_size), 
-                synth->voice_modulators_block + (i * block_size), 
+                synth->voice_modulators_block + (i * MOD_MAX_SOURCE), 
+                &synth->lfo,
+                synth->voice_xmod_buffer,
+                synth->voice_oversample_buffer,
+                synth->voice_env_buffer,
+                synth->voice_lfo_buffer,
                 sample_rate, block_size);
   }
 
@@ -74,6 +141,25 @@ void synth_render(struct synth *synth, float *left, float *right, size_t block_s
   // DWT_INIT();
   // DWT_CLEAR();
 
+  /* Every voice with a note renders, shutdown included, so all of them share the measured time */
+  uint8_t active_voices = count_rendered_voices(synth);
+  governor_block_start(&synth->governor);
+
+  /* Pass on any change in the MIDI clock tempo, once per block rather than per clock */
+  if (tempo_update(&synth->tempo))
+  {
+    synth_set_tempo(synth, synth->tempo.bpm);
+  }
+
+  /* A free running LFO is rendered here once, the voices copy it */
+  if (synth->lfo.trigger_mode_param == LFO_FREE)
+  {
+    lfo_render(&synth->lfo, block_size);
+  }
+
+  /* The work above is counted as overhead, not shared out as per-voice cost */
+  governor_voices_start(&synth->governor);
+
   voice_render(&synth->voice[0]);
   voice_render(&synth->voice[1]);
   voice_render(&synth->voice[2]);
@@ -83,45 +169,79 @@ void synth_render(struct synth *synth, float *left, float *right, size_t block_s
   voice_render(&synth->voice[6]);
   voice_render(&synth->voice[7]);
 
+  governor_voices_end(&synth->governor);
+
   /*
    * Accumulate rendered samples into output buffers.
    *
-   * While the buffers occupy a contiguous memory block (allocated by the synth), I found
-   * using a single pointer to accumulate the entire block was slower than the individual
-   * pointers below.  The copy takes around 40us which is acceptable (originally 76us 
-   * using array notation/for loops).
+   * Only voices that rendered audio this block are mixed, idle and retired voices are
+   * skipped entirely.  Each voice is panned into both channels with the gains its amp worked
+   * out, ramped across the block, and the headroom scaling is folded into those gains.  The
+   * first voice initialises the buffers so each voice costs a single pass over its samples.
    */
 
   const float scale = synth->poly_attenuation;
 
-  float *restrict lp = left;
-  float *restrict end = lp + block_size;
-  float *restrict rp = right;
+  struct amp *mix[MAX_VOICES];
+  uint8_t mix_count = 0;
+
+  for (int i = 0; i < MAX_VOICES; i++)
+  {
+    if (synth->voice[i].audible)
+    {
+      mix[mix_count++] = &synth->voice[i].amp;
+    }
+  }
 
-  float *restrict v0p = synth->voice[0].samples;
-  float *restrict v1p = synth->voice[1].samples;
-  float *restrict v2p = synth->voice[2].samples;
-  float *restrict v3p = synth->voice[3].samples;
-  float *restrict v4p = synth->voice[4].samples;
-  float *restrict v5p = synth->voice[5].samples;
-  float *restrict v6p = synth->voice[6].samples;
-  float *restrict v7p = synth->voice[7].samples;
+  if (mix_count == 0)
+  {
+    memset(left, 0, block_size * sizeof(float));
+    memset(right, 0, block_size * sizeof(float));
+  }
 
-  while (lp < end)
+  for (uint8_t v = 0; v < mix_count; v++)
   {
-    *lp = (*v0p + *v1p + *v2p + *v3p + *v4p + *v5p + *v6p + *v7p) * scale;
-    *rp = *lp; /* MONO so just copy */
+    const float *restrict vp = mix[v]->samples;
+    float *restrict lp = left;
+    float *restrict rp = right;
+    float *restrict end = lp + block_size;
+
+    float left_gain = mix[v]->left_gain * scale;
+    float right_gain = mix[v]->right_gain * scale;
+    float left_step = mix[v]->left_step * scale;
+    float right_step = mix[v]->right_step * scale;
+
+    if (v == 0)
+    {
+#pragma GCC unroll 4
+      while (lp < end)
+      {
+        float sample = *vp++;
+        *lp++ = sample * left_gain;
+        *rp++ = sample * right_gain;
+        left_gain += left_step;
+        right_gain += right_step;
+      }
+    }
+    else
+    {
+#pragma GCC unroll 4
+      while (lp < end)
+      {
+        float sample = *vp++;
+        *lp++ += sample * left_gain;
+        *rp++ += sample * right_gain;
+        left_gain += left_step;
+        right_gain += right_step;
+      }
+    }
+  }
 
-    lp++;
-    rp++;
-    v0p++;
-    v1p++;
-    v2p++;
-    v3p++;
-    v4p++;
-    v5p++;
-    v6p++;
-    v7p++;
+  /* Fast release the quietest voice if the current voices will not fit in the next block */
+  governor_update(&synth->governor, active_voices);
+  if (synth->voice_mode == VOICE_POLY && governor_overloaded(&synth->governor, count_sounding_voices(synth)))
+  {
+    synth_shed_voice(synth);
   }
 
   // DWT_OUTPUT("Output");
@@ -136,32 +256,57 @@ void synth_render(struct synth *synth, float *left, float *right, size_t block_s
  * \param byte0 the status byte
  * \param byte1 MIDI data byte 1
  * \param byte2 MIDI data byte 2
+ * \param timestamp receive time of a real-time message, in cpu clock ticks
  */
-void synth_midi_message(struct synth *synth, uint8_t byte0, uint8_t byte1, uint8_t byte2)
+void synth_midi_message(struct synth *synth, uint8_t byte0, uint8_t byte1, uint8_t byte2, uint32_t timestamp)
 {
   RTT_ASSERT(synth);
 
-  switch (byte0)
+  /* Channel messages carry the channel in the low nibble of the status byte */
+  uint8_t status = (byte0 < MIDI_STATUS_SYS_EX_START) ? (byte0 & 0xF0) : byte0;
+  uint8_t channel = byte0 & 0x0F;
+
+  switch (status)
   {
   case MIDI_STATUS_NOTE_OFF:
-    synth_note_off(synth, byte1);
+    synth_pedal_note_off(synth, channel, byte1);
     break;
 
   case MIDI_STATUS_NOTE_ON:
   {
     if (byte2 > 0)
     {
-      synth_note_on(synth, byte1, byte2);
+      synth_pedal_note_on(synth, channel, byte1, byte2);
     }
     else
     {
       /* Some devices send a note on with a value of 0 to indicate note off*/
-      synth_note_off(synth, byte1);
+      synth_pedal_note_off(synth, channel, byte1);
     }
     break;
   }
   case MIDI_STATUS_CONTROL_CHANGE:
   {
+    /* Pedals defer note-offs rather than changing a parameter */
+    if (byte1 == MIDI_CC_HOLDPEDAL)
+    {
+      synth_sustain_pedal(synth, channel, byte2 >= 64);
+      break;
+    }
+
+    if (byte1 == MIDI_CC_SOSTENUTO)
+    {
+      synth_sostenuto_pedal(synth, channel, byte2 >= 64);
+      break;
+    }
+
+    /* Channel mode messages switch the voice mode directly */
+    if (byte1 == MIDI_CC_MONOMODEON || byte1 == MIDI_CC_POLYMODEON)
+    {
+      param_set(VOICE_MODE, (byte1 == MIDI_CC_MONOMODEON) ? 1.0f : 0.0f);
+      break;
+    }
+
     uint8_t id = synth->cc_to_param_map[byte1];
     if (id != MIDI_CC_UNSUPPORTED)
     {
@@ -169,6 +314,19 @@ void synth_midi_message(struct synth *synth, uint8_t byte0, uint8_t byte1, uint8
     }
     break;
   }
+  case MIDI_STATUS_CLOCK:
+    tempo_clock(&synth->tempo, timestamp);
+    break;
+
+  case MIDI_STATUS_START:
+    /* The free running LFO restarts on the downbeat */
+    lfo_reset(&synth->lfo);
+    break;
+
+  case MIDI_STATUS_STOP:
+    tempo_stop(&synth->tempo);
+    break;
+
   default:
   }
 }
@@ -186,12 +344,27 @@ void synth_update_params(struct synth *synth)
   RTT_ASSERT(synth);
 
   /* Small parameter count so just refresh them all */
-  for (int i = 0; i < SYNTH_PARAM_MAX - 1; i++)
+  for (int i = 0; i < SYNTH_PARAM_MAX; i++)
   {
     /* Replace our cached shared copy with updated values from the DAE store */
     synth->params[i] = param_get(i);
   }
 
+  /* Changing voice mode silences everything, as a MIDI mode change would */
+  enum voice_mode voice_mode = PARAM_TO_INT(synth->params[VOICE_MODE], 0, VOICE_MODE_MAX-1);
+  if (voice_mode != synth->voice_mode)
+  {
+    synth_note_all_off(synth);
+    synth->note_stack.count = 0;
+    synth->voice_mode = voice_mode;
+  }
+
+  synth->note_priority = PARAM_TO_INT(synth->params[NOTE_PRIORITY], 0, NOTE_PRIORITY_MAX-1);
+  synth->legato = PARAM_TO_INT(synth->params[LEGATO_MODE], 0, SWITCH_MAX-1);
+
+  lfo_update_params(&synth->lfo, synth->params[LFO_RATE], synth->params[LFO_TRIGGER_MODE], synth->params[LFO_RANGE],
+                    synth->params[LFO_SYNC]);
+
   /* Signal the voices that our cached parameters have changed, they need to update their modules etc */
   for (int i = 0; i < MAX_VOICES; i++)
   {
@@ -199,6 +372,53 @@ void synth_update_params(struct synth *synth)
   }
 }
 
+/**
+ * synth_set_seg_env
+ * \brief Gives every voice a user defined segment envelope
+ * \note The definition survives patch changes, the segment envelope parameters other than
+ *       sync then have no effect.  No stages goes back to the DAHDSR built from the patch.
+ *       Call from the audio task, between blocks.
+ * \param synth the synth instance
+ * \param stages the stages, level, time (ms, or beats when synced) and curve of each
+ * \param stage_count the number of stages, up to SEG_ENV_MAX_STAGES or 0 for the DAHDSR
+ * \param sustain_stage holds at the end of this stage while the note is held, or SEG_ENV_NONE
+ * \param loop_start the first stage repeated while the note is held, or SEG_ENV_NONE
+ * \param loop_end the last stage repeated while the note is held, or SEG_ENV_NONE
+ */
+void synth_set_seg_env(struct synth *synth, const struct seg_stage *stages, uint8_t stage_count,
+                       int8_t sustain_stage, int8_t loop_start, int8_t loop_end)
+{
+  RTT_ASSERT(synth);
+
+  for (int i = 0; i < MAX_VOICES; i++)
+  {
+    voice_set_seg_env(&synth->voice[i], stages, stage_count, sustain_stage, loop_start, loop_end);
+  }
+}
+
+/*
+ * Finds the released voice with the lowest output level, stealing this is
+ * less noticeable than cutting off a held note.
+ */
+static inline struct voice *find_quietest_released_voice(struct synth *synth)
+{
+  float level = INFINITY;
+  struct voice *quietest_voice = NULL;
+
+  for (int i = 0; i < MAX_VOICES; i++)
+  {
+    struct voice *voice = &synth->voice[i];
+
+    if (!voice->note_pending && voice->note_on && voice->amp_env.state == ENV_RELEASE && voice->amp.peak < level)
+    {
+      level = voice->amp.peak;
+      quietest_voice = voice;
+    }
+  }
+
+  return quietest_voice;
+}
+
 /*
  * Finds the oldest voice currently playing to steal and reuse for the most
  * recent note received.
@@ -221,13 +441,13 @@ static inline struct voice *find_oldest_voice_to_steal(struct synth *synth)
 }
 
 /*
- * Finds a voice playing the specified note for MIDI note-off handling.
+ * Finds a voice playing the specified note on the channel for MIDI note-off handling.
  * The age comparison is maintained as a defensive measure, as normally
  * only one voice should be playing any given note. This ensures we
  * always find the correct voice even in edge cases where voice allocation
  * might temporarily have duplicates.
  */
-static inline struct voice *find_oldest_voice_by_note(struct synth *synth, uint8_t note)
+static inline struct voice *find_oldest_voice_by_note(struct synth *synth, uint8_t channel, uint8_t note)
 {
   int8_t age = -1;
   struct voice *oldest_voice = NULL;
@@ -235,7 +455,7 @@ static inline struct voice *find_oldest_voice_by_note(struct synth *synth, uint8
   for (int i = 0; i < MAX_VOICES; i++)
   {
 
-    if (synth->voice[i].note_on && synth->voice[i].current_note == note && synth->voice[i].age > age)
+    if (synth->voice[i].note_on && synth->voice[i].current_note == note && synth->voice[i].channel == channel && synth->voice[i].age > age)
     {
       age = synth->voice[i].age;
       oldest_voice = &synth->voice[i];
@@ -257,6 +477,78 @@ static inline void age_voices(struct synth *synth)
   }
 }
 
+/* Counts the voices that are sounding and not already being shut down */
+static uint8_t count_sounding_voices(struct synth *synth)
+{
+  uint8_t count = 0;
+
+  for (int i = 0; i < MAX_VOICES; i++)
+  {
+    if (synth->voice[i].note_on && synth->voice[i].amp_env.state != ENV_SHUTDOWN)
+    {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/* Counts the voices that will render this block, including those being shut down */
+static uint8_t count_rendered_voices(struct synth *synth)
+{
+  uint8_t count = 0;
+
+  for (int i = 0; i < MAX_VOICES; i++)
+  {
+    if (synth->voice[i].note_on)
+    {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/*
+ * Quickly releases the quietest sounding voice, by its output level in the last block, to
+ * reduce the CPU load.  The voice becomes free once its envelope has returned to zero.
+ */
+static void synth_shed_voice(struct synth *synth)
+{
+  struct voice *quietest = NULL;
+  float quietest_level = INFINITY;
+
+  for (int i = 0; i < MAX_VOICES; i++)
+  {
+    struct voice *voice = &synth->voice[i];
+
+    if (voice->note_on && !voice->note_pending && voice->amp_env.state != ENV_SHUTDOWN)
+    {
+      if (voice->amp.peak < quietest_level)
+      {
+        quietest_level = voice->amp.peak;
+        quietest = voice;
+      }
+    }
+  }
+
+  if (quietest)
+  {
+    env_gen_rtz(&quietest->amp_env);
+  }
+}
+
+/* Passes a new tempo to the shared LFO and every voice */
+static void synth_set_tempo(struct synth *synth, float bpm)
+{
+  lfo_set_tempo(&synth->lfo, bpm);
+
+  for (int i = 0; i < MAX_VOICES; i++)
+  {
+    voice_set_tempo(&synth->voice[i], bpm);
+  }
+}
+
 /* Finds the first voice that is not playing */
 static inline struct voice *find_free_voice(struct synth *synth)
 {
@@ -278,45 +570,71 @@ static inline struct voice *find_free_voice(struct synth *synth)
  * \note this looks in priority order for:
  *  - A voice that is already sounding this note (retrigger)
  *  - A free voice
+ *  - The quietest released voice (to steal and reuse)
  *  - The oldest voice playing (to steal and reuse)
  */
-static void synth_note_on(struct synth *synth, uint8_t note, uint8_t velocity)
+static void synth_note_on(struct synth *synth, uint8_t channel, uint8_t note, uint8_t velocity)
 {
   struct voice *voice = NULL;
+  float glide_from = synth->last_note_freq;
+
+  if (synth->voice_mode == VOICE_MONO)
+  {
+    synth_mono_note_on(synth, note, velocity);
+    return;
+  }
+
+  synth->last_note_freq = MIDI_FREQ_TABLE[note];
 
   /* Check for already playing this note*/
-  voice = find_oldest_voice_by_note(synth, note);
+  voice = find_oldest_voice_by_note(synth, channel, note);
   if (voice)
   {
-    voice_note_on(voice, note, velocity);
+    voice_note_on(voice, note, velocity, glide_from);
     return;
   }
 
-  /* Find an available voice */
-  voice = find_free_voice(synth);
+  /* Find an available voice, unless the governor says there is no time to render it */
+  if (count_sounding_voices(synth) < synth->governor.voice_limit)
+  {
+    voice = find_free_voice(synth);
+  }
+
   if (voice)
   {
     age_voices(synth);
-    voice_note_on(voice, note, velocity);
+    voice->channel = channel;
+    voice_note_on(voice, note, velocity, glide_from);
     return;
   }
 
-  /* Steal oldest voice */
-  voice = find_oldest_voice_to_steal(synth);
+  /* Steal a voice, preferring one that is already fading out */
+  voice = find_quietest_released_voice(synth);
+  if (!voice)
+  {
+    voice = find_oldest_voice_to_steal(synth);
+  }
+
   if (voice)
   {
     age_voices(synth);
-    voice_note_on(voice, note, velocity);
+    voice->channel = channel;
+    voice_note_on(voice, note, velocity, glide_from);
   }
 }
 
-static void synth_note_off(struct synth *synth, uint8_t note)
+static void synth_note_off(struct synth *synth, uint8_t channel, uint8_t note)
 {
+  if (synth->voice_mode == VOICE_MONO)
+  {
+    synth_mono_note_off(synth, note);
+    return;
+  }
 
   /* Find the voice playing the note */
   for (int i = 0; i < MAX_VOICES; i++)
   {
-    struct voice *voice = find_oldest_voice_by_note(synth, note);
+    struct voice *voice = find_oldest_voice_by_note(synth, channel, note);
     if (voice)
     {
       voice_note_off(voice, note);
@@ -332,3 +650,210 @@ static void synth_note_all_off(struct synth *synth)
     voice_note_off(&synth->voice[i], synth->voice[i].current_note);
   }
 }
+
+/* Removes a note from the held note stack, preserving the playing order */
+static void note_stack_remove(struct note_stack *stack, uint8_t note)
+{
+  uint8_t j = 0;
+
+  for (uint8_t i = 0; i < stack->count; i++)
+  {
+    if (stack->note[i] != note)
+    {
+      stack->note[j] = stack->note[i];
+      stack->velocity[j] = stack->velocity[i];
+      j++;
+    }
+  }
+  stack->count = j;
+}
+
+/* Adds a note to the top of the held note stack, dropping the oldest if it is full */
+static void note_stack_push(struct note_stack *stack, uint8_t note, uint8_t velocity)
+{
+  note_stack_remove(stack, note);
+
+  if (stack->count == NOTE_STACK_SIZE)
+  {
+    memmove(&stack->note[0], &stack->note[1], NOTE_STACK_SIZE - 1);
+    memmove(&stack->velocity[0], &stack->velocity[1], NOTE_STACK_SIZE - 1);
+    stack->count--;
+  }
+
+  stack->note[stack->count] = note;
+  stack->velocity[stack->count] = velocity;
+  stack->count++;
+}
+
+/* Returns the stack index of the held note that should sound, the stack must not be empty */
+static uint8_t note_stack_select(struct note_stack *stack, enum note_priority priority)
+{
+  uint8_t selected = stack->count - 1;
+
+  if (priority == NOTE_PRIORITY_LAST)
+  {
+    return selected;
+  }
+
+  for (uint8_t i = 0; i < stack->count; i++)
+  {
+    if ((priority == NOTE_PRIORITY_LOW && stack->note[i] < stack->note[selected]) ||
+        (priority == NOTE_PRIORITY_HIGH && stack->note[i] > stack->note[selected]))
+    {
+      selected = i;
+    }
+  }
+
+  return selected;
+}
+
+/*
+ * Sounds a note on the single mono voice.  When legato is enabled and the voice is still
+ * held the note changes without retriggering the envelopes, otherwise it is retriggered.
+ */
+static void synth_mono_play(struct synth *synth, uint8_t note, uint8_t velocity)
+{
+  struct voice *voice = &synth->voice[0];
+  enum env_state state = voice->amp_env.state;
+  float glide_from = synth->last_note_freq;
+
+  bool held = voice->note_on && !voice->note_pending && state >= ENV_ATTACK && state <= ENV_SUSTAIN;
+
+  if (held && voice->current_note == note)
+  {
+    return;
+  }
+
+  synth->last_note_freq = MIDI_FREQ_TABLE[note];
+
+  if (held && synth->legato)
+  {
+    voice_note_legato(voice, note, velocity, glide_from);
+  }
+  else
+  {
+    voice_note_on(voice, note, velocity, glide_from);
+  }
+}
+
+static void synth_mono_note_on(struct synth *synth, uint8_t note, uint8_t velocity)
+{
+  note_stack_push(&synth->note_stack, note, velocity);
+
+  uint8_t i = note_stack_select(&synth->note_stack, synth->note_priority);
+  synth_mono_play(synth, synth->note_stack.note[i], synth->note_stack.velocity[i]);
+}
+
+static void synth_mono_note_off(struct synth *synth, uint8_t note)
+{
+  note_stack_remove(&synth->note_stack, note);
+
+  if (synth->note_stack.count == 0)
+  {
+    voice_note_off(&synth->voice[0], note);
+    return;
+  }
+
+  /* Fall back to the remaining held note with the highest priority */
+  uint8_t i = note_stack_select(&synth->note_stack, synth->note_priority);
+  synth_mono_play(synth, synth->note_stack.note[i], synth->note_stack.velocity[i]);
+}
+
+#define NOTE_BIT_WORD(note) ((note) >> 5)
+#define NOTE_BIT_MASK(note) (1UL << ((note) & 31))
+
+/*
+ * Key down, a note that is still held by a pedal is released from the deferred set and
+ * the normal note-on handling then reuses the voice that is already sounding it.
+ */
+static void synth_pedal_note_on(struct synth *synth, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+  struct pedal_state *pedal = &synth->pedals[channel];
+
+  pedal->keys[NOTE_BIT_WORD(note)] |= NOTE_BIT_MASK(note);
+  pedal->deferred[NOTE_BIT_WORD(note)] &= ~NOTE_BIT_MASK(note);
+
+  synth_note_on(synth, channel, note, velocity);
+}
+
+/* Key up, the note-off is deferred while a pedal is holding the note */
+static void synth_pedal_note_off(struct synth *synth, uint8_t channel, uint8_t note)
+{
+  struct pedal_state *pedal = &synth->pedals[channel];
+  uint32_t mask = NOTE_BIT_MASK(note);
+  uint8_t word = NOTE_BIT_WORD(note);
+
+  pedal->keys[word] &= ~mask;
+
+  if (pedal->sustain || (pedal->sostenuto && (pedal->sostenuto_notes[word] & mask)))
+  {
+    pedal->deferred[word] |= mask;
+    return;
+  }
+
+  synth_note_off(synth, channel, note);
+}
+
+/* Dispatches the deferred note-offs that are no longer held by either pedal */
+static void synth_release_deferred(struct synth *synth, uint8_t channel)
+{
+  struct pedal_state *pedal = &synth->pedals[channel];
+
+  if (pedal->sustain)
+  {
+    return;
+  }
+
+  for (uint8_t word = 0; word < NOTE_BITSET_WORDS; word++)
+  {
+    uint32_t release = pedal->deferred[word];
+
+    if (pedal->sostenuto)
+    {
+      release &= ~pedal->sostenuto_notes[word];
+    }
+
+    pedal->deferred[word] &= ~release;
+
+    while (release)
+    {
+      uint8_t bit = __builtin_ctz(release);
+      release &= release - 1;
+      synth_note_off(synth, channel, (word << 5) + bit);
+    }
+  }
+}
+
+static void synth_sustain_pedal(struct synth *synth, uint8_t channel, bool down)
+{
+  struct pedal_state *pedal = &synth->pedals[channel];
+
+  pedal->sustain = down;
+
+  if (!down)
+  {
+    synth_release_deferred(synth, channel);
+  }
+}
+
+/* Sostenuto only holds the keys that were down when the pedal was pressed */
+static void synth_sostenuto_pedal(struct synth *synth, uint8_t channel, bool down)
+{
+  struct pedal_state *pedal = &synth->pedals[channel];
+
+  if (down == pedal->sostenuto)
+  {
+    return;
+  }
+
+  pedal->sostenuto = down;
+
+  if (down)
+  {
+    memcpy(pedal->sostenuto_notes, pedal->keys, sizeof(pedal->keys));
+    return;
+  }
+
+  synth_release_deferred(synth, channel);
+  memset(pedal->sostenuto_notes, 0, sizeof(pedal->sostenuto_notes));
+}
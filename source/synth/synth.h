@@ -21,6 +21,10 @@
 #include "dae.h"
 #include "params.h"
 #include "voice.h"
+#include "lfo.h"
+#include "tempo.h"
+#include "governor.h"
+#include "bench.h"
 #include "trace.h"
 
 /*
@@ -28,6 +32,30 @@
 */
 #define MAX_VOICES (8)
 
+/* Number of held notes remembered by the monophonic mode */
+#define NOTE_STACK_SIZE (16)
+
+/* Pedal state is tracked per MIDI channel, notes are held as bitsets (1 bit per note) */
+#define MIDI_CHANNELS (16)
+#define NOTE_BITSET_WORDS (128 / 32)
+
+struct pedal_state
+{
+  bool sustain;
+  bool sostenuto;
+  uint32_t keys[NOTE_BITSET_WORDS];            /* Keys physically held down */
+  uint32_t sostenuto_notes[NOTE_BITSET_WORDS]; /* Keys held when the sostenuto pedal went down */
+  uint32_t deferred[NOTE_BITSET_WORDS];        /* Note-offs waiting for a pedal release */
+};
+
+/* Held notes in the order they were played, oldest first */
+struct note_stack
+{
+  uint8_t note[NOTE_STACK_SIZE];
+  uint8_t velocity[NOTE_STACK_SIZE];
+  uint8_t count;
+};
+
 
 struct synth
 {
@@ -40,6 +68,19 @@ struct synth
   /* Buffers */
   float *voice_buffer_block;
   float *voice_modulators_block;
+  float *voice_xmod_buffer;
+  float *voice_oversample_buffer;
+  float *voice_env_buffer;
+  float *voice_lfo_buffer;
+
+  /* Free running LFO, rendered once per block for all voices */
+  struct lfo lfo;
+  float lfo_modulators[MOD_MAX_SOURCE];
+  const float *lfo_mod_samples[MOD_MAX_SOURCE];
+  float *lfo_buffer;
+
+  /* Tempo tracked from MIDI clock, for synced LFO and envelope rates */
+  struct tempo tempo;
 
   /* Patch and params */
   float params[SYNTH_PARAM_MAX];
@@ -48,12 +89,26 @@ struct synth
   /* For portamento/glissando */
   float last_note_freq;  
 
+  /* Monophonic mode */
+  enum voice_mode voice_mode;
+  enum note_priority note_priority;
+  bool legato;
+  struct note_stack note_stack;
+
+  /* Sustain and sostenuto pedals */
+  struct pedal_state pedals[MIDI_CHANNELS];
+
+  /* Limits polyphony to what can be rendered before the block deadline */
+  struct governor governor;
+
 };
 
 /* API */
 void synth_init(struct synth *synth, float sample_rate, size_t block_size, uint8_t *midi_channel);
 void synth_render(struct synth *synth, float *left, float *right, size_t block_size);
-void synth_midi_message(struct synth *synth, uint8_t byte0, uint8_t byte1, uint8_t byte2);
+void synth_midi_message(struct synth *synth, uint8_t byte0, uint8_t byte1, uint8_t byte2, uint32_t timestamp);
 void synth_update_params(struct synth *synth);
+void synth_set_seg_env(struct synth *synth, const struct seg_stage *stages, uint8_t stage_count,
+                       int8_t sustain_stage, int8_t loop_start, int8_t loop_end);
 
 #endif /* __SYNTH_H__ */
\ No newline at end of file
@@ -0,0 +1,123 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#include "tempo.h"
+
+/**
+ * tempo_init
+ * \brief Sets up the MIDI clock tempo tracker at the default tempo
+ * \param tempo the tracker instance
+ * \param ticks_per_second rate of the clock the MIDI timestamps are taken from
+ */
+void tempo_init(struct tempo *tempo, float ticks_per_second)
+{
+  RTT_ASSERT(tempo);
+  RTT_ASSERT(ticks_per_second > 0.0f);
+
+  tempo->bpm_scale = ticks_per_second * 60.0f / TEMPO_PPQN;
+  tempo->min_interval = tempo->bpm_scale / TEMPO_MAX_BPM;
+  tempo->max_interval = tempo->bpm_scale / TEMPO_MIN_BPM;
+
+  tempo->bpm = TEMPO_DEFAULT_BPM;
+  tempo->period = tempo->bpm_scale / TEMPO_DEFAULT_BPM;
+  tempo->locked = false;
+  tempo->outliers = 0;
+  tempo->stamp_valid = false;
+  tempo->last_stamp = 0;
+}
+
+/**
+ * tempo_clock
+ * \brief Tracks a MIDI clock, called for each of the 24 per quarter note
+ * \note Runs in the audio task, only the interval is smoothed here, the tempo is worked out
+ *       once per block by tempo_update.
+ * \param tempo the tracker instance
+ * \param timestamp the time the clock was received, in cpu clock ticks
+ */
+void tempo_clock(struct tempo *tempo, uint32_t timestamp)
+{
+  RTT_ASSERT(tempo);
+
+  float interval = (float)(uint32_t)(timestamp - tempo->last_stamp);
+  bool valid = tempo->stamp_valid;
+
+  tempo->last_stamp = timestamp;
+  tempo->stamp_valid = true;
+
+  if (!valid || interval < tempo->min_interval || interval > tempo->max_interval)
+  {
+    return;
+  }
+
+  if (!tempo->locked)
+  {
+    tempo->period = interval;
+    tempo->locked = true;
+    tempo->outliers = 0;
+    return;
+  }
+
+  float deviation = fabsf(interval - tempo->period);
+
+  if (deviation < tempo->period * TEMPO_TOLERANCE)
+  {
+    tempo->period += (interval - tempo->period) * TEMPO_SMOOTHING;
+    tempo->outliers = 0;
+  }
+  else if (++tempo->outliers >= TEMPO_RELOCK)
+  {
+    /* Consistently off, a jump in tempo rather than jitter */
+    tempo->period = interval;
+    tempo->outliers = 0;
+  }
+}
+
+/**
+ * tempo_stop
+ * \brief The clock has stopped, the gap before it restarts is not an interval
+ * \param tempo the tracker instance
+ */
+void tempo_stop(struct tempo *tempo)
+{
+  RTT_ASSERT(tempo);
+
+  tempo->stamp_valid = false;
+  tempo->outliers = 0;
+}
+
+/**
+ * tempo_update
+ * \brief Converts the tracked period to BPM, call once per block
+ * \param tempo the tracker instance
+ * \return true if the tempo has changed and should be passed on
+ */
+bool tempo_update(struct tempo *tempo)
+{
+  RTT_ASSERT(tempo);
+
+  if (!tempo->locked)
+  {
+    return false;
+  }
+
+  float bpm = tempo->bpm_scale / tempo->period;
+
+  if (fabsf(bpm - tempo->bpm) < TEMPO_HYSTERESIS)
+  {
+    return false;
+  }
+
+  tempo->bpm = bpm;
+  return true;
+}
@@ -0,0 +1,69 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+#ifndef __TEMPO_H__
+#define __TEMPO_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "trace.h"
+
+/* MIDI clock pulses per quarter note */
+#define TEMPO_PPQN (24)
+
+/* Tempo used until a clock has been tracked */
+#define TEMPO_DEFAULT_BPM (120.0f)
+
+/* Clocks outside this range are ignored, a longer gap is the clock stopping */
+#define TEMPO_MIN_BPM (20.0f)
+#define TEMPO_MAX_BPM (300.0f)
+
+/* Smoothing of the clock period, averages out the jitter over about a beat */
+#define TEMPO_SMOOTHING (0.05f)
+
+/* Intervals further than this fraction from the period are jitter and ignored, unless
+   TEMPO_RELOCK of them in a row show the tempo has really changed */
+#define TEMPO_TOLERANCE (0.25f)
+#define TEMPO_RELOCK (3)
+
+/* Change in BPM needed before the new tempo is passed on */
+#define TEMPO_HYSTERESIS (0.05f)
+
+struct tempo
+{
+  /* Tempo passed on to the synced modules */
+  float bpm;
+
+  /* Smoothed time between clocks, in cpu clock ticks */
+  float period;
+  bool locked;
+  uint8_t outliers;
+
+  /* Time of the last clock */
+  uint32_t last_stamp;
+  bool stamp_valid;
+
+  /* Fixed at init so there are no divisions per clock */
+  float min_interval;
+  float max_interval;
+  float bpm_scale; /* BPM x period */
+};
+
+void tempo_init(struct tempo *tempo, float ticks_per_second);
+void tempo_clock(struct tempo *tempo, uint32_t timestamp);
+void tempo_stop(struct tempo *tempo);
+bool tempo_update(struct tempo *tempo);
+
+#endif /* __TEMPO_H__ */
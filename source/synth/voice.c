@@ -15,10 +15,26 @@
 
 extern const float MIDI_FREQ_TABLE[128];
 
-void voice_init(struct voice *voice, float *params, float *samples, float *modulators, float fsr, size_t block_size)
+/* Range to convert the normalised portamento time */
+#define PORTAMENTO_MS_MAX (5000.0f)
+#define PORTAMENTO_POWER_EXP (2.0f)
+
+/* Distinct random generator seeds for each voice and generator */
+#define VOICE_SEED(id, n) (2463534242UL + ((id) * 3 + (n)) * 0x9E3779B9UL)
+
+static void voice_start_glide(struct voice *voice, float glide_from);
+static void voice_ring_mod(struct voice *voice, size_t block_size);
+static void voice_set_oversample(struct voice *voice, enum oversample_mode mode);
+
+void voice_init(struct voice *voice, float *params, float *samples, float *modulators, const struct lfo *shared_lfo, float *xmod, float *oversampled, float *envelopes, float *lfo_samples, float fsr, size_t block_size)
 {
   RTT_ASSERT(voice != NULL);
   RTT_ASSERT(params != NULL);
+  RTT_ASSERT(shared_lfo != NULL);
+  RTT_ASSERT(xmod != NULL);
+  RTT_ASSERT(oversampled != NULL);
+  RTT_ASSERT(envelopes != NULL);
+  RTT_ASSERT(lfo_samples != NULL);
   RTT_ASSERT(fsr > 0.0f);
   RTT_ASSERT(block_size > 0);
 
@@ -28,26 +44,47 @@ void voice_init(struct voice *voice, float *params, float *samples, float *modul
 
   voice->note_on = false;
   voice->note_pending = false;
+  voice->audible = false;
+  voice->silent_blocks = 0;
   voice->current_note = 0;
+  voice->channel = 0;
   voice->pending_note = 0;
   voice->current_velocity = 0;
   voice->pending_velocity = 0;
   voice->current_pitch = 0.0f;
   voice->pending_pitch = 0.0f;
+  voice->pending_glide_from = 0.0f;
+  voice->portamento_time_param = 0.0f;
+  voice->portamento_mode_param = GLIDE_CONSTANT_TIME;
   voice->block_size = block_size;
   voice->samples = samples;
   voice->modulators = modulators;
+  voice->shared_lfo = shared_lfo;
+  voice->xmod = xmod;
+  voice->envelopes = envelopes;
+  voice->lfo_samples = lfo_samples;
+  memset(voice->mod_samples, 0, sizeof(voice->mod_samples));
+  voice->xmod_mode_param = XMOD_OFF;
+  voice->xmod_depth_param = 0.0f;
+  voice->oversample_param = OVERSAMPLE_OFF;
+  voice->oversample = 1;
+  voice->oversampled = oversampled;
+  voice->render = samples;
+  halfband_reset(&voice->decimator);
 
   /* Initialise modulators */
-  env_gen_init(&voice->amp_env, voice->fsr, voice->block_size, &voice->modulators[MOD_AMP_ENV_LEVEL]);
-  env_gen_init(&voice->mod_env, voice->fsr, voice->block_size, &voice->modulators[MOD_ENV_LEVEL]);
-  lfo_init(&voice->lfo, voice->fsr, voice->modulators);
+  env_gen_init(&voice->amp_env, voice->fsr, voice->block_size, &voice->modulators[MOD_AMP_ENV_LEVEL], voice->envelopes);
+  env_gen_init(&voice->mod_env, voice->fsr, voice->block_size, &voice->modulators[MOD_ENV_LEVEL], voice->envelopes + voice->block_size);
+  seg_env_init(&voice->seg_env, voice->fsr, voice->block_size, &voice->modulators[MOD_SEG_ENV]);
+  lfo_init(&voice->lfo, voice->fsr, voice->modulators, voice->mod_samples, voice->lfo_samples, VOICE_SEED(voice->id, 0));
+  mod_matrix_init(&voice->matrix, voice->modulators, voice->mod_samples);
 
   /* Initialise audio signal chain */
-  osc_init(&voice->osc1, voice->fsr, voice->samples, voice->modulators, true);
-  osc_init(&voice->osc2, voice->fsr, voice->samples, voice->modulators, false);
-  amp_init(&voice->amp, voice->fsr, voice->samples, voice->modulators);
-  filter_init(&voice->filter, voice->fsr, voice->samples, voice->modulators);
+  osc_init(&voice->osc1, voice->fsr, voice->samples, voice->modulators, voice->mod_samples, &voice->matrix, true);
+  osc_init(&voice->osc2, voice->fsr, voice->samples, voice->modulators, voice->mod_samples, &voice->matrix, false);
+  amp_init(&voice->amp, voice->fsr, voice->samples, voice->modulators, voice->mod_samples, voice->matrix.targets, voice->envelopes);
+  noise_init(&voice->noise, voice->samples, voice->modulators, VOICE_SEED(voice->id, 1), VOICE_SEED(voice->id, 2));
+  filter_init(&voice->filter, voice->fsr, voice->samples, voice->modulators, voice->mod_samples, &voice->matrix);
 }
 
 void voice_reset(struct voice *voice)
@@ -56,14 +93,18 @@ void voice_reset(struct voice *voice)
   osc_reset(&voice->osc1);
   osc_reset(&voice->osc2);
   env_gen_reset(&voice->amp_env);
+  seg_env_reset(&voice->seg_env);
   lfo_reset(&voice->lfo);
   filter_reset(&voice->filter);
+  halfband_reset(&voice->decimator);
 }
 
 void voice_render(struct voice *voice)
 {
   RTT_ASSERT(voice != NULL);
 
+  voice->audible = false;
+
   if (!voice->note_on)
   {
     return;
@@ -73,12 +114,15 @@ void voice_render(struct voice *voice)
   if (voice->amp_env.state == ENV_OFF && !voice->note_pending)
   {
     voice->note_on = false;
+    voice->amp.peak = 0.0f;
     lfo_reset(&voice->lfo);
     osc_reset(&voice->osc1);
     osc_reset(&voice->osc2);
     env_gen_reset(&voice->amp_env);
     env_gen_reset(&voice->mod_env);
+    seg_env_reset(&voice->seg_env);
     filter_reset(&voice->filter);
+    halfband_reset(&voice->decimator);
     // memset(voice->samples, 0, voice->block_size * sizeof(float));
     return;
   }
@@ -93,6 +137,7 @@ void voice_render(struct voice *voice)
     voice->current_vel_factor = voice->pending_vel_factor;
     voice->note_pending = false;
     voice->note_on = true;
+    voice->silent_blocks = 0;
 
     voice->age = 0;
 
@@ -100,44 +145,92 @@ void voice_render(struct voice *voice)
     lfo_note_on(&voice->lfo);
     osc_note_on(&voice->osc1, voice->current_pitch);
     osc_note_on(&voice->osc2, voice->current_pitch);
-    filter_note_on(&voice->filter, voice->current_note);
+    voice_start_glide(voice, voice->pending_glide_from);
+    filter_note_on(&voice->filter, voice->current_note, voice->current_velocity);
+    amp_note_on(&voice->amp, voice->current_note);
     env_gen_note_on(&voice->amp_env, voice->current_note, voice->current_velocity);
     env_gen_note_on(&voice->mod_env, voice->current_note, voice->current_velocity);
+    seg_env_note_on(&voice->seg_env);
   }
 
   // DWT_INIT();
   // DWT_CLEAR();
 
-  lfo_render(&voice->lfo, voice->block_size);
+  /* Only a note triggered LFO needs rendering per voice */
+  if (voice->lfo.trigger_mode_param == LFO_NOTE)
+  {
+    lfo_render(&voice->lfo, voice->block_size);
+  }
+  else
+  {
+    lfo_share(voice->shared_lfo, voice->modulators, voice->mod_samples);
+  }
+  noise_render_modulator(&voice->noise);
   // DWT_OUTPUT("LFO");
   // DWT_CLEAR();
 
-  osc_render(&voice->osc1, voice->block_size);
+  /* The sound sources and filter render at the oversampled rate */
+  size_t render_size = voice->block_size * voice->oversample;
+
+  osc_render(&voice->osc1, render_size);
   // DWT_OUTPUT("OSC1");
   // DWT_CLEAR();
 
-  osc_render(&voice->osc2, voice->block_size);
+  osc_render(&voice->osc2, render_size);
   // DWT_OUTPUT("OSC2");
   // DWT_CLEAR();
 
+  if (voice->xmod_mode_param == XMOD_RING)
+  {
+    voice_ring_mod(voice, render_size);
+  }
+
+  noise_render(&voice->noise, render_size);
+
   env_gen_render(&voice->amp_env, voice->block_size);
   // DWT_OUTPUT("ENV1");
   // DWT_CLEAR();
 
   env_gen_render(&voice->mod_env, voice->block_size);
+  seg_env_render(&voice->seg_env);
+
+  /* After the envelopes so the filter and amp see this block's levels, the oscillators pick
+     up the matrix a block later as they do the envelopes.  A route from an audio rate
+     source reads that source's samples as the module renders. */
+  mod_matrix_render(&voice->matrix);
   // DWT_OUTPUT("ENV2");
   // DWT_CLEAR();
 
-  filter_render(&voice->filter, voice->block_size);
+  filter_render(&voice->filter, render_size);
   // DWT_OUTPUT("FILTER");
   // DWT_CLEAR();
 
+  if (voice->oversample > 1)
+  {
+    halfband_decimate(&voice->decimator, voice->samples, voice->render, voice->block_size);
+  }
+
   amp_render(&voice->amp, voice->block_size);
   // DWT_OUTPUT("AMP");
   // DWT_CLEAR();
+
+  voice->audible = true;
+
+  /* Retire a releasing voice early once it is inaudible rather than waiting for the envelope tail */
+  if (voice->amp_env.state == ENV_RELEASE && voice->amp.peak < VOICE_SILENCE_THRESHOLD)
+  {
+    if (++voice->silent_blocks >= VOICE_SILENCE_BLOCKS)
+    {
+      env_gen_reset(&voice->amp_env);
+    }
+  }
+  else
+  {
+    voice->silent_blocks = 0;
+  }
 }
 
-void voice_note_on(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity)
+void voice_note_on(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity, float glide_from)
 {
   RTT_ASSERT(voice != NULL);
 
@@ -153,6 +246,7 @@ void voice_note_on(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity
     /* We're just playing the note and the user retriggered it, jump to ATTACK phase*/
     env_gen_note_on(&voice->amp_env, voice->current_note, voice->current_velocity);
     env_gen_note_on(&voice->mod_env, voice->current_note, voice->current_velocity);
+    seg_env_note_on(&voice->seg_env);
     return;
   }
 
@@ -168,15 +262,19 @@ void voice_note_on(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity
     voice->current_vel_factor = (midi_velocity / 127.0f) * 0.9f + 0.1f;
     voice->note_pending = false;
     voice->note_on = true;
+    voice->silent_blocks = 0;
     voice->age = 0;
 
     /* New note on */
     lfo_note_on(&voice->lfo);
     osc_note_on(&voice->osc1, voice->current_pitch);
     osc_note_on(&voice->osc2, voice->current_pitch);
-    filter_note_on(&voice->filter, voice->current_note);
+    voice_start_glide(voice, glide_from);
+    filter_note_on(&voice->filter, voice->current_note, voice->current_velocity);
+    amp_note_on(&voice->amp, voice->current_note);
     env_gen_note_on(&voice->amp_env, voice->current_note, voice->current_velocity);
     env_gen_note_on(&voice->mod_env, voice->current_note, voice->current_velocity);
+    seg_env_note_on(&voice->seg_env);
     return;
   }
   else
@@ -191,10 +289,43 @@ void voice_note_on(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity
     voice->pending_velocity = midi_velocity;
     voice->pending_pitch = MIDI_FREQ_TABLE[midi_note];
     voice->pending_vel_factor = (midi_velocity / 127.0f) * 0.9f + 0.1f;
+    voice->pending_glide_from = glide_from;
     env_gen_rtz(&voice->amp_env);
   }
 }
 
+/**
+ * voice_note_legato
+ * \brief Moves a sounding voice to a new note without retriggering it
+ * \note Used by the monophonic mode when notes overlap, the envelopes continue from
+ *       their current state and the oscillator phase is not reset.
+ * \param voice the voice instance
+ * \param midi_note the new note
+ * \param midi_velocity the new velocity
+ * \param glide_from the frequency to glide from (0 for none)
+ */
+void voice_note_legato(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity, float glide_from)
+{
+  RTT_ASSERT(voice != NULL);
+
+  if (!voice->note_on || voice->note_pending)
+  {
+    voice_note_on(voice, midi_note, midi_velocity, glide_from);
+    return;
+  }
+
+  voice->current_note = midi_note;
+  voice->current_velocity = midi_velocity;
+  voice->current_pitch = MIDI_FREQ_TABLE[midi_note];
+  voice->current_vel_factor = (midi_velocity / 127.0f) * 0.9f + 0.1f;
+
+  osc_note_change(&voice->osc1, voice->current_pitch);
+  osc_note_change(&voice->osc2, voice->current_pitch);
+  voice_start_glide(voice, glide_from);
+  filter_note_on(&voice->filter, voice->current_note, voice->current_velocity);
+  amp_note_on(&voice->amp, voice->current_note);
+}
+
 void voice_note_off(struct voice *voice, uint8_t midi_note)
 {
   RTT_ASSERT(voice != NULL);
@@ -203,7 +334,41 @@ void voice_note_off(struct voice *voice, uint8_t midi_note)
   {
     env_gen_note_off(&voice->amp_env);
     env_gen_note_off(&voice->mod_env);
+    seg_env_note_off(&voice->seg_env);
+  }
+}
+
+/* Tempo for the synced segment envelope and note triggered LFO */
+void voice_set_tempo(struct voice *voice, float bpm)
+{
+  RTT_ASSERT(voice != NULL);
+
+  seg_env_set_tempo(&voice->seg_env, bpm);
+  lfo_set_tempo(&voice->lfo, bpm);
+}
+
+/* User defined segment envelope, with no stages it goes back to the patch's DAHDSR */
+void voice_set_seg_env(struct voice *voice, const struct seg_stage *stages, uint8_t stage_count,
+                       int8_t sustain_stage, int8_t loop_start, int8_t loop_end)
+{
+  RTT_ASSERT(voice != NULL);
+
+  if (stage_count == 0)
+  {
+    seg_env_use_dahdsr(&voice->seg_env);
+    return;
+  }
+
+  RTT_ASSERT(stages != NULL);
+
+  seg_env_define(&voice->seg_env, stage_count);
+
+  for (uint8_t i = 0; i < stage_count; i++)
+  {
+    seg_env_set_stage(&voice->seg_env, i, stages[i].level, stages[i].time, stages[i].curve);
   }
+
+  seg_env_set_loop(&voice->seg_env, sustain_stage, loop_start, loop_end);
 }
 
 /*
@@ -222,7 +387,9 @@ void voice_update_params(struct voice *voice)
                     voice->params[OSC1_LEVEL],
                     voice->params[OSC1_MOD_SOURCE],
                     voice->params[OSC1_MOD_DEPTH],
-                    voice->params[OSC1_PW]);
+                    voice->params[OSC1_PW],
+                    voice->params[PWM_SOURCE],
+                    voice->params[PWM_DEPTH]);
 
   osc_update_params(&voice->osc2,
                     voice->params[OSC2_WAVE],
@@ -232,7 +399,9 @@ void voice_update_params(struct voice *voice)
                     voice->params[OSC2_LEVEL],
                     voice->params[OSC2_MOD_SOURCE],
                     voice->params[OSC2_MOD_DEPTH],
-                    voice->params[OSC2_PW]);
+                    voice->params[OSC2_PW],
+                    voice->params[PWM_SOURCE],
+                    voice->params[PWM_DEPTH]);
 
   env_gen_update_params(&voice->amp_env,
                         voice->params[AMP_ENV_ATTACK],
@@ -252,14 +421,45 @@ void voice_update_params(struct voice *voice)
                         voice->params[MOD_ENV_NOTE_TRACK],
                         voice->params[MOD_ENV_VEL_SENS]);
 
+  seg_env_update_params(&voice->seg_env,
+                        voice->params[SEG_ENV_DELAY],
+                        voice->params[SEG_ENV_ATTACK],
+                        voice->params[SEG_ENV_HOLD],
+                        voice->params[SEG_ENV_DECAY],
+                        voice->params[SEG_ENV_SUSTAIN],
+                        voice->params[SEG_ENV_RELEASE],
+                        voice->params[SEG_ENV_LOOP],
+                        voice->params[SEG_ENV_CURVE],
+                        voice->params[SEG_ENV_SYNC]);
+
   amp_update_params(&voice->amp,
                     voice->params[AMP_VOLUME],
                     voice->params[AMP_MOD_SOURCE],
-                    voice->params[AMP_MOD_DEPTH]);
+                    voice->params[AMP_MOD_DEPTH],
+                    voice->params[PAN],
+                    voice->params[PAN_KEY_TRACK]);
+
+  noise_update_params(&voice->noise,
+                      voice->params[NOISE_TYPE],
+                      voice->params[NOISE_LEVEL]);
 
   lfo_update_params(&voice->lfo,
                     voice->params[LFO_RATE],
-                    voice->params[LFO_TRIGGER_MODE]);
+                    voice->params[LFO_TRIGGER_MODE],
+                    voice->params[LFO_RANGE],
+                    voice->params[LFO_SYNC]);
+
+  mod_matrix_update_params(&voice->matrix, &voice->params[MOD_MATRIX1_SOURCE]);
+
+  voice->xmod_mode_param = PARAM_TO_INT(voice->params[OSC_XMOD_MODE], 0, XMOD_MODE_MAX-1);
+  voice->xmod_depth_param = voice->params[OSC_XMOD_DEPTH];
+  osc_xmod(&voice->osc1, voice->xmod_mode_param, voice->xmod, voice->xmod_depth_param);
+  osc_xmod(&voice->osc2, voice->xmod_mode_param, voice->xmod, voice->xmod_depth_param);
+
+  voice_set_oversample(voice, PARAM_TO_INT(voice->params[OVERSAMPLE_MODE], 0, OVERSAMPLE_MODE_MAX-1));
+
+  voice->portamento_time_param = PARAM_TO_POWER(voice->params[PORTAMENTO_TIME], 0.0f, PORTAMENTO_MS_MAX, PORTAMENTO_POWER_EXP);
+  voice->portamento_mode_param = PARAM_TO_INT(voice->params[PORTAMENTO_MODE], 0, GLIDE_MODE_MAX-1);
 
   filter_update_params(&voice->filter,
                        voice->params[FILTER_TYPE],
@@ -268,5 +468,73 @@ void voice_update_params(struct voice *voice)
                        voice->params[FILTER_SATURATION],
                        voice->params[FILTER_MOD_DEPTH],
                        voice->params[FILTER_MOD_SOURCE],
-                       voice->params[FILTER_NOTE_TRACK]);
-}
\ No newline at end of file
+                       voice->params[FILTER_NOTE_TRACK],
+                       voice->params[FILTER_VEL_TRACK]);
+}
+
+/*
+ * Starts both oscillators gliding from the previous note to the current one. In constant time
+ * mode every glide takes the portamento time, in constant rate mode the portamento time is the
+ * time taken to glide one octave.
+ */
+static void voice_start_glide(struct voice *voice, float glide_from)
+{
+  if (glide_from <= 0.0f || voice->portamento_time_param <= 0.0f)
+  {
+    return;
+  }
+
+  float semi_tones = 12.0f * log2f(glide_from / voice->current_pitch);
+  float glide_samples = voice->portamento_time_param * voice->fsr * 0.001f;
+  float rate = (voice->portamento_mode_param == GLIDE_CONSTANT_TIME) ? fabsf(semi_tones) / glide_samples : 12.0f / glide_samples;
+
+  osc_glide(&voice->osc1, semi_tones, rate);
+  osc_glide(&voice->osc2, semi_tones, rate);
+}
+
+/*
+ * Ring modulates OSC2, which is alone in the voice buffer, by OSC1 in the shared buffer.  The
+ * depth blends from the plain OSC2 output to the full ring modulated product.
+ */
+static void voice_ring_mod(struct voice *voice, size_t block_size)
+{
+  float *restrict ptr = voice->render;
+  float *restrict end = ptr + block_size;
+  const float *restrict mod = voice->xmod;
+
+  float dry = 1.0f - voice->xmod_depth_param;
+  float wet = voice->xmod_depth_param;
+
+#pragma GCC unroll 4
+  while (ptr < end)
+  {
+    *ptr++ *= dry + wet * *mod++;
+  }
+}
+
+/*
+ * Switches the oscillators, noise and filter between the normal and oversampled render rates.
+ * The decimator history is cleared so the old rate's samples are not mixed into the new.
+ */
+static void voice_set_oversample(struct voice *voice, enum oversample_mode mode)
+{
+  if (mode == voice->oversample_param)
+  {
+    return;
+  }
+
+  voice->oversample_param = mode;
+  voice->oversample = (mode == OVERSAMPLE_2X) ? 2 : 1;
+
+  osc_set_oversample(&voice->osc1, voice->oversample);
+  osc_set_oversample(&voice->osc2, voice->oversample);
+  filter_set_oversample(&voice->filter, voice->oversample);
+  halfband_reset(&voice->decimator);
+
+  /* The amp always works on the voice's own buffer at the base rate */
+  voice->render = (voice->oversample > 1) ? voice->oversampled : voice->samples;
+  voice->osc1.samples = voice->render;
+  voice->osc2.samples = voice->render;
+  voice->noise.samples = voice->render;
+  voice->filter.samples = voice->render;
+}
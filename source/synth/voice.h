@@ -27,12 +27,25 @@
 #include "amp.h"
 #include "osc.h"
 #include "env_gen.h"
+#include "seg_env.h"
 #include "lfo.h"
+#include "mod_matrix.h"
 #include "filter.h"
+#include "noise.h"
 
 #include "trace.h"
 
+/*
+ * A releasing voice is retired once its output peak has stayed below the threshold for a
+ * number of consecutive blocks, long enough to span a cycle of the lowest notes.
+ */
+#ifndef VOICE_SILENCE_THRESHOLD
+#define VOICE_SILENCE_THRESHOLD (3.2e-5f) /* -90dB */
+#endif
+#define VOICE_SILENCE_BLOCKS (16)
 
+/* Voice and cross modulation buffers hold a block at the highest oversampling rate */
+#define VOICE_OVERSAMPLE_MAX (2)
 
 struct voice
 {
@@ -45,8 +58,13 @@ struct voice
 
   /* Voice note management */
   int8_t age;
+  uint8_t channel; /* MIDI channel of the note, set by the synth */
   bool note_on, note_pending;
 
+  /* Output level tracking, a voice is audible if it rendered samples this block */
+  bool audible;
+  uint8_t silent_blocks;
+
   /* MIDI values */
   uint8_t current_note, pending_note;
   uint8_t current_velocity, pending_velocity;
@@ -55,29 +73,64 @@ struct voice
   float current_pitch, pending_pitch;
   float current_vel_factor, pending_vel_factor;
 
+  /* Portamento */
+  float pending_glide_from;
+  float portamento_time_param;
+  enum glide_mode portamento_mode_param;
+
   /* Samples */
   __attribute__((aligned(4))) float *samples;
 
-  /* Modulation values */
+  /* Modulation values, and the synth's free running LFO shared by all voices */
   __attribute__((aligned(4))) float *modulators;
-  
-  
+  const struct lfo *shared_lfo;
+
+  /* Per-sample modulation, a block for each source rendered at audio rate, otherwise NULL */
+  const float *mod_samples[MOD_MAX_SOURCE];
+
+  /* Per-sample LFO waveforms, shared by all voices */
+  __attribute__((aligned(4))) float *lfo_samples;
+
+  /* Cross modulation (OSC1 -> OSC2), the per-sample buffer is shared by all voices */
+  __attribute__((aligned(4))) float *xmod;
+  enum xmod_mode xmod_mode_param;
+  float xmod_depth_param;
+
+  /* Per-sample amp and mod envelope levels, one block each and shared by all voices */
+  __attribute__((aligned(4))) float *envelopes;
+
+  /* Oscillators to filter run at the oversampled rate, decimated before the amplifier.  The
+     oversampled block is rendered in a buffer shared by all voices and decimated into the voice's
+     own, otherwise the sources and filter render straight into the voice's buffer */
+  enum oversample_mode oversample_param;
+  uint8_t oversample;
+  __attribute__((aligned(4))) float *oversampled;
+  float *render;
+  struct halfband decimator;
+
   /* Signal chain */
   struct amp amp;
   struct env_gen amp_env;
   struct env_gen mod_env;
+  struct seg_env seg_env;
   struct osc osc1;
   struct osc osc2;
   struct lfo lfo;
+  struct noise noise;
   struct filter filter;
+  struct mod_matrix matrix;
 };
 
 /* API */
-void voice_init(struct voice *voice, float *params, float *samples, float *modulators, float fsr, size_t block_size);
+void voice_init(struct voice *voice, float *params, float *samples, float *modulators, const struct lfo *shared_lfo, float *xmod, float *oversampled, float *envelopes, float *lfo_samples, float fsr, size_t block_size);
 void voice_reset(struct voice *voice);
 void voice_render(struct voice *voice);
-void voice_note_on(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity);
+void voice_note_on(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity, float glide_from);
+void voice_note_legato(struct voice *voice, uint8_t midi_note, uint8_t midi_velocity, float glide_from);
 void voice_note_off(struct voice *voice, uint8_t midi_note);
 void voice_update_params(struct voice *voice);
+void voice_set_tempo(struct voice *voice, float bpm);
+void voice_set_seg_env(struct voice *voice, const struct seg_stage *stages, uint8_t stage_count,
+                       int8_t sustain_stage, int8_t loop_start, int8_t loop_end);
 
 #endif /* __VOICE_H__ */
\ No newline at end of file
@@ -0,0 +1,33 @@
+/*
+  ------------------------------------------------------------------------------
+   Frugi
+   Author: ydigikat
+  ------------------------------------------------------------------------------
+   MIT License
+   Copyright (c) 2025 YDigiKat
+
+   Permission to use, copy, modify, and/or distribute this code for any purpose
+   with or without fee is hereby granted, provided the above copyright notice and
+   this permission notice appear in all copies.
+  ------------------------------------------------------------------------------
+*/
+
+#ifndef __WAVETABLE_H__
+#define __WAVETABLE_H__
+
+/*
+ * Band-limited wavetables for the wavetable oscillator.
+ *
+ * The table data is generated at build time by tools/wavetable_gen.py, which reads the
+ * dimensions below, and is placed in flash.  Each frame (table position) has one table per
+ * octave (mip level), level n holds only the harmonics that stay below Nyquist when the
+ * table is played with a phase increment of up to 2^n / WT_LENGTH.  Tables carry one guard
+ * sample so the interpolation never has to wrap.
+ */
+#define WT_LENGTH (256)
+#define WT_LEVELS (8)
+#define WT_FRAMES (8)
+
+extern const float wavetable[WT_FRAMES][WT_LEVELS][WT_LENGTH + 1];
+
+#endif /* __WAVETABLE_H__ */
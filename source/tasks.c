@@ -67,5 +67,5 @@ void dae_process_block(float *left, float *right, size_t block_size)
 
 void dae_handle_midi(struct midi_msg *msg)
 {  
-  synth_midi_message(&synth, msg->data[0], msg->data[1], msg->data[2]);
+  synth_midi_message(&synth, msg->data[0], msg->data[1], msg->data[2], msg->timestamp);
 }
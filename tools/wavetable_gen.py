@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# ------------------------------------------------------------------------------
+#  Frugi
+#  Author: ydigikat
+# ------------------------------------------------------------------------------
+#  MIT License
+#  Copyright (c) 2025 YDigiKat
+#
+#  Permission to use, copy, modify, and/or distribute this code for any purpose
+#  with or without fee is hereby granted, provided the above copyright notice an
+#  this permission notice appear in all copies.
+# ------------------------------------------------------------------------------
+"""
+Generates the band-limited, mip-mapped wavetables used by the wavetable oscillator.
+
+Usage: wavetable_gen.py <wavetable.h> <output.c>
+
+The table dimensions (WT_LENGTH, WT_LEVELS, WT_FRAMES) are read from the header so the
+generated data always matches the declaration.  Each frame is built additively from its
+harmonic series, level n keeps the harmonics up to (WT_LENGTH / 2) >> n.
+"""
+import math
+import re
+import sys
+
+
+def pulse(duty):
+    """Pulse as the difference of two phase shifted saws"""
+    def harmonic(n):
+        w = 2.0 * math.pi * n * duty
+        return (math.sin(w) / n, (math.cos(w) - 1.0) / n)
+    return harmonic
+
+
+def partials(amplitudes):
+    """Sine partials at the given harmonic numbers"""
+    return lambda n: (0.0, amplitudes.get(n, 0.0))
+
+
+# Each frame returns the (cosine, sine) amplitude of harmonic n, frames are in table position order
+FRAMES = [
+    ("sine", partials({1: 1.0})),
+    ("triangle", lambda n: (0.0, ((-1.0) ** ((n - 1) // 2)) / (n * n) if n % 2 else 0.0)),
+    ("saw", lambda n: (0.0, -1.0 / n)),
+    ("square", lambda n: (0.0, 1.0 / n if n % 2 else 0.0)),
+    ("pulse 25%", pulse(0.25)),
+    ("pulse 12.5%", pulse(0.125)),
+    ("organ", partials({1: 1.0, 2: 0.8, 3: 0.6, 4: 0.5, 6: 0.4, 8: 0.3, 10: 0.2, 12: 0.15, 16: 0.1})),
+    ("formant", lambda n: (0.0, math.exp(-(((n - 7.0) / 2.5) ** 2)) + 0.25 / n)),
+]
+
+
+def read_dimensions(header):
+    dims = {}
+    with open(header) as f:
+        for name, value in re.findall(r"#define\s+WT_(\w+)\s+\((\d+)\)", f.read()):
+            dims[name] = int(value)
+    return dims["LENGTH"], dims["LEVELS"], dims["FRAMES"]
+
+
+def render(harmonic, length, max_harmonic, sin_table):
+    table = [0.0] * length
+    for n in range(1, max_harmonic + 1):
+        a, b = harmonic(n)
+        if a == 0.0 and b == 0.0:
+            continue
+        quarter = length // 4
+        for i in range(length):
+            k = (n * i) % length
+            table[i] += a * sin_table[(k + quarter) % length] + b * sin_table[k]
+    return table
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+
+    length, levels, frames = read_dimensions(sys.argv[1])
+
+    if frames != len(FRAMES):
+        sys.exit("WT_FRAMES (%d) does not match the %d frames defined" % (frames, len(FRAMES)))
+
+    sin_table = [math.sin(2.0 * math.pi * i / length) for i in range(length)]
+
+    lines = [
+        "/* Generated by tools/wavetable_gen.py - do not edit */",
+        '#include "wavetable.h"',
+        "",
+        "const float wavetable[WT_FRAMES][WT_LEVELS][WT_LENGTH + 1] = {",
+    ]
+
+    for name, harmonic in FRAMES:
+        # Harmonic WT_LENGTH / 2 would sit exactly on the table's own Nyquist so it is excluded
+        tables = [render(harmonic, length, max(1, min(length // 2 - 1, (length // 2) >> level)), sin_table)
+                  for level in range(levels)]
+
+        # Normalise on the full bandwidth table so every level of a frame has the same gain
+        scale = 1.0 / max(abs(s) for s in tables[0])
+
+        lines.append("    /* %s */" % name)
+        lines.append("    {")
+        for table in tables:
+            table = table + table[:1]  # guard sample
+            values = ", ".join("%.8ef" % (s * scale) for s in table)
+            lines.append("        {%s}," % values)
+        lines.append("    },")
+
+    lines.append("};")
+    lines.append("")
+
+    with open(sys.argv[2], "w") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()